@@ -0,0 +1,122 @@
+/**************************************************************************
+* Copyright 2015 John Denholm                                             *
+*                                                                         *
+* Licensed under the Apache License, Version 2.0 (the "License");         *
+* you may not use this file except in compliance with the License.        *
+* You may obtain a copy of the License at                                 *
+*                                                                         *
+*     http://www.apache.org/licenses/LICENSE-2.0                          *
+*                                                                         *
+* Unless required by applicable law or agreed to in writing, software     *
+* distributed under the License is distributed on an "AS IS" BASIS,       *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.*
+* See the License for the specific language governing permissions and     *
+* limitations under the License.                                          *
+*                                                                         *
+*                                                                         *
+* numbench.c - compare str_to_dbl against strtod                          *
+*                                                                         *
+* Build from the top level, after a make:                                 *
+*   gcc -std=c11 -O2 -I src/shared -o numbench scripts/numbench.c \       *
+*       src/shared/app_shared.a -lm                                       *
+*                                                                         *
+* Updates:                                                                *
+**************************************************************************/
+
+#include "shared.h"
+
+#define NB_VALUES		100000
+#define NB_LOOPS		50
+#define NB_STRLEN		32
+
+
+static char nb_vals[NB_VALUES][NB_STRLEN];
+
+
+// the shapes of value ministry actually sees
+static void nb_fill( void )
+{
+	int i;
+
+	srandom( 42 );
+
+	for( i = 0; i < NB_VALUES; ++i )
+		switch( i % 8 )
+		{
+			case 0:
+			case 1:
+			case 2:
+				snprintf( nb_vals[i], NB_STRLEN, "%ld", random( ) % 1000 );
+				break;
+			case 3:
+				snprintf( nb_vals[i], NB_STRLEN, "%ld", random( ) );
+				break;
+			case 4:
+				snprintf( nb_vals[i], NB_STRLEN, "%.3f", (double) random( ) / 1000.0 );
+				break;
+			case 5:
+				snprintf( nb_vals[i], NB_STRLEN, "-%.6f", (double) random( ) / (double) RAND_MAX );
+				break;
+			case 6:
+				snprintf( nb_vals[i], NB_STRLEN, "%.4e", (double) random( ) * 1.0e-12 );
+				break;
+			case 7:
+				snprintf( nb_vals[i], NB_STRLEN, "%.17g", (double) random( ) / 3.0 );
+				break;
+		}
+}
+
+
+static double nb_time( int fast, double *sum )
+{
+	struct timespec a, b;
+	double s = 0;
+	int i, j;
+
+	clock_gettime( CLOCK_MONOTONIC, &a );
+
+	for( j = 0; j < NB_LOOPS; ++j )
+		for( i = 0; i < NB_VALUES; ++i )
+			s += ( fast ) ? str_to_dbl( nb_vals[i], NULL ) : strtod( nb_vals[i], NULL );
+
+	clock_gettime( CLOCK_MONOTONIC, &b );
+
+	*sum = s;
+
+	return ( (double) ( b.tv_sec - a.tv_sec ) * 1000000000.0 + (double) ( b.tv_nsec - a.tv_nsec ) )
+	     / ( (double) NB_LOOPS * NB_VALUES );
+}
+
+
+int main( int ac, char **av )
+{
+	double ts, tf, ss, sf, x, y;
+	char *ex, *ey;
+	int i, bad = 0;
+
+	nb_fill( );
+
+	// check they agree, bit for bit, on value and end pointer
+	for( i = 0; i < NB_VALUES; ++i )
+	{
+		x = strtod( nb_vals[i], &ex );
+		y = str_to_dbl( nb_vals[i], &ey );
+
+		if( memcmp( &x, &y, sizeof( double ) ) || ex != ey )
+		{
+			if( bad < 10 )
+				printf( "Mismatch: '%s' -> %.17g vs %.17g\n", nb_vals[i], x, y );
+			++bad;
+		}
+	}
+
+	ts = nb_time( 0, &ss );
+	tf = nb_time( 1, &sf );
+
+	printf( "strtod:      %7.2f ns/value  (sum %g)\n", ts, ss );
+	printf( "str_to_dbl:  %7.2f ns/value  (sum %g)\n", tf, sf );
+	printf( "Speedup:     %7.2fx\n", ts / tf );
+	printf( "Mismatches:  %d of %d\n", bad, NB_VALUES );
+
+	return ( bad ) ? 1 : 0;
+}
@@ -0,0 +1,172 @@
+/**************************************************************************
+* Copyright 2015 John Denholm                                             *
+*                                                                         *
+* Licensed under the Apache License, Version 2.0 (the "License");         *
+* you may not use this file except in compliance with the License.        *
+* You may obtain a copy of the License at                                 *
+*                                                                         *
+*     http://www.apache.org/licenses/LICENSE-2.0                          *
+*                                                                         *
+* Unless required by applicable law or agreed to in writing, software     *
+* distributed under the License is distributed on an "AS IS" BASIS,       *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.*
+* See the License for the specific language governing permissions and     *
+* limitations under the License.                                          *
+*                                                                         *
+*                                                                         *
+* rendercheck.c - compare render_dbl against printf                       *
+*                                                                         *
+* Build from the top level, after a make:                                 *
+*   gcc -std=c11 -O2 -pthread -I src/ministry -I src/shared \             *
+*       -o rendercheck scripts/rendercheck.c \                            *
+*       $(find src/ministry -name '*.o' ! -name main.o) \                 *
+*       src/shared/app_shared.a -lm -lcurl -lmicrohttpd -ljson-c \        *
+*       -lgnutls                                                          *
+*                                                                         *
+* Updates:                                                                *
+**************************************************************************/
+
+#include "ministry.h"
+
+#define RC_VALUES		1000000
+#define RC_MAX_PREC		15
+
+// main.o has this
+MIN_CTL *ctl = NULL;
+
+int render_dbl( char *p, double v, int prec );
+
+
+static int64_t rc_checks = 0;
+static int rc_bad = 0;
+
+
+static void rc_fail( double v, int prec, const char *want, const char *got )
+{
+	if( rc_bad < 20 )
+		printf( "Mismatch: %.17g prec %d -> '%s', expected '%s'\n", v, prec, got, want );
+
+	++rc_bad;
+}
+
+
+static void rc_shortest( double v );
+
+
+// printf, less trailing zeros, and never -0
+static void rc_fixed( double v, int prec )
+{
+	char want[512], got[64];
+	int l;
+
+	// too big for places, render_dbl goes shortest instead
+	if( fabs( v ) >= 9.0e18 )
+	{
+		rc_shortest( v );
+		return;
+	}
+
+	l = snprintf( want, 512, "%.*f", prec, v );
+
+	if( memchr( want, '.', l ) )
+	{
+		while( want[l - 1] == '0' )
+			--l;
+		if( want[l - 1] == '.' )
+			--l;
+	}
+	want[l] = '\0';
+
+	if( !strcmp( want, "-0" ) )
+		strcpy( want, "0" );
+
+	l = render_dbl( got, v, prec );
+	got[l] = '\0';
+
+	++rc_checks;
+
+	if( strcmp( want, got ) )
+		rc_fail( v, prec, want, got );
+}
+
+
+// reads back the same, and one digit fewer would not
+static void rc_shortest( double v )
+{
+	char got[64], less[512];
+	int l, d, n;
+
+	l = render_dbl( got, v, -1 );
+	got[l] = '\0';
+
+	++rc_checks;
+
+	if( strtod( got, NULL ) != v || !strcmp( got, "-0" ) )
+	{
+		rc_fail( v, -1, "round trip", got );
+		return;
+	}
+
+	// count the significant digits we wrote - trailing zeros
+	// on a whole number are place holders, not digits
+	for( d = 0, n = 0, l = 0; got[l] && got[l] != 'e'; ++l )
+		if( isdigit( got[l] ) && ( n || got[l] != '0' ) )
+		{
+			++n;
+			if( got[l] != '0' )
+				d = n;
+		}
+
+	if( d > 1 )
+	{
+		snprintf( less, 512, "%.*g", d - 1, v );
+		if( strtod( less, NULL ) == v )
+			rc_fail( v, -1, less, got );
+	}
+}
+
+
+int main( int ac, char **av )
+{
+	double v, specials[] = { 0.0, -0.0, 5e-324, -5e-324, 2.2250738585072014e-308, 1e-310, 0.1, 1e22, 123456789012345678.0 };
+	int i, p;
+
+	srandom( 42 );
+
+	// exact .5 ties at no places - even the whole part
+	for( i = -100000; i <= 100000; ++i )
+		rc_fixed( (double) i + 0.5, 0 );
+
+	// and at every other precision
+	for( p = 1; p <= RC_MAX_PREC; ++p )
+		for( i = 0; i < 1000; ++i )
+		{
+			v = (double) ( random( ) % 100000 ) + ( (double) ( 2 * ( random( ) % 16 ) + 1 ) / 32.0 );
+			rc_fixed( v, p );
+			rc_fixed( -v, p );
+		}
+
+	// a spread of magnitudes and signs
+	for( i = 0; i < RC_VALUES; ++i )
+	{
+		v = ( (double) random( ) / (double) RAND_MAX ) * pow( 10.0, (double) ( random( ) % 24 ) - 8 );
+		if( i & 0x1 )
+			v = -v;
+
+		rc_fixed( v, i % ( RC_MAX_PREC + 1 ) );
+
+		if( !( i % 10 ) )
+			rc_shortest( v );
+	}
+
+	for( i = 0; i < (int) ( sizeof( specials ) / sizeof( double ) ); ++i )
+	{
+		rc_shortest( specials[i] );
+		for( p = 0; p <= RC_MAX_PREC; ++p )
+			rc_fixed( specials[i], p );
+	}
+
+	printf( "Mismatches:  %d of %ld\n", rc_bad, rc_checks );
+
+	return ( rc_bad ) ? 1 : 0;
+}
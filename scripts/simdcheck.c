@@ -0,0 +1,200 @@
+/**************************************************************************
+* Copyright 2015 John Denholm                                             *
+*                                                                         *
+* Licensed under the Apache License, Version 2.0 (the "License");         *
+* you may not use this file except in compliance with the License.        *
+* You may obtain a copy of the License at                                 *
+*                                                                         *
+*     http://www.apache.org/licenses/LICENSE-2.0                          *
+*                                                                         *
+* Unless required by applicable law or agreed to in writing, software     *
+* distributed under the License is distributed on an "AS IS" BASIS,       *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.*
+* See the License for the specific language governing permissions and     *
+* limitations under the License.                                          *
+*                                                                         *
+*                                                                         *
+* simdcheck.c - compare the AVX2 summing kernels against the scalar loops *
+*                                                                         *
+* Build from the top level, after a make:                                 *
+*   gcc -std=c11 -O2 -pthread -I src/ministry -I src/shared \             *
+*       -o simdcheck scripts/simdcheck.c \                                *
+*       $(find src/ministry -name '*.o' ! -name main.o) \                 *
+*       src/shared/app_shared.a -lm -lcurl -lmicrohttpd -ljson-c \        *
+*       -lgnutls                                                          *
+*                                                                         *
+* Updates:                                                                *
+**************************************************************************/
+
+#include "ministry.h"
+
+#define SC_MAX_LEN		200000
+#define SC_ROUNDS		40
+
+// both are compensated sums, each within 2 eps of the sum of the
+// magnitudes, so they differ by no more than 4
+#define SC_TOL_EPS		4.0
+
+// main.o has this
+MIN_CTL *ctl = NULL;
+
+
+static double sc_list[SC_MAX_LEN];
+static int64_t sc_checks = 0;
+static int sc_bad = 0;
+
+
+static void sc_fail( const char *what, int64_t len, int shape, double want, double got, double tol )
+{
+	if( sc_bad < 20 )
+		printf( "Mismatch: %s, len %ld shape %d -> %.17g, expected %.17g (tolerance %g)\n",
+			what, len, shape, got, want, tol );
+
+	++sc_bad;
+}
+
+
+static void sc_close( const char *what, int64_t len, int shape, double want, double got, double mag )
+{
+	double tol = SC_TOL_EPS * DBL_EPSILON * mag;
+
+	++sc_checks;
+
+	if( fabs( want - got ) > tol )
+		sc_fail( what, len, shape, want, got, tol );
+}
+
+
+static void sc_same( const char *what, int64_t len, int shape, double want, double got )
+{
+	++sc_checks;
+
+	if( want != got )
+		sc_fail( what, len, shape, want, got, 0 );
+}
+
+
+static double sc_rand( void )
+{
+	return (double) random( ) / (double) RAND_MAX;
+}
+
+
+// the shapes of value ministry actually sees, and some it shouldn't
+static void sc_fill( int64_t len, int shape )
+{
+	int64_t i;
+
+	for( i = 0; i < len; ++i )
+		switch( shape )
+		{
+			case 0:		// timings
+				sc_list[i] = sc_rand( ) * 1000000.0;
+				break;
+			case 1:		// big offset, small spread
+				sc_list[i] = 1.0e9 + sc_rand( );
+				break;
+			case 2:		// either sign, cancelling
+				sc_list[i] = ( sc_rand( ) - 0.5 ) * 1000.0;
+				break;
+			default:	// wide exponents
+				sc_list[i] = sc_rand( ) * pow( 10.0, (double) ( random( ) % 30 ) - 15 );
+				if( i & 0x1 )
+					sc_list[i] = -sc_list[i];
+				break;
+		}
+}
+
+
+// the scalar loop from maths_moments, before it scales the sums
+static void sc_moments( int64_t len, double mean, double *m2, double *m3, double *m4 )
+{
+	double l2 = 0, l3 = 0, l4 = 0, df, pr;
+	int64_t i;
+
+	*m2 = *m3 = *m4 = 0;
+
+	for( i = 0; i < len; ++i )
+	{
+		df = sc_list[i] - mean;
+		pr = df * df;
+		maths_kahan_sum( pr, m2, &l2 );
+		pr *= df;
+		maths_kahan_sum( pr, m3, &l3 );
+		pr *= df;
+		maths_kahan_sum( pr, m4, &l4 );
+	}
+
+	*m2 -= l2;
+	*m3 -= l3;
+	*m4 -= l4;
+}
+
+
+static void sc_check( int64_t len, int shape )
+{
+	double sum, min, max, vsum, vmin, vmax, mean, m[3], v[3], mag[4], df;
+	int64_t i;
+
+	sc_fill( len, shape );
+
+	// maths_simd is still off, so these are the scalar loops
+	maths_kahan_summation_range( sc_list, (int) len, &sum, &min, &max );
+
+	maths_simd_kahan( sc_list, len, &vsum, &vmin, &vmax );
+
+	mean = sum / (double) len;
+
+	mag[0] = mag[1] = mag[2] = mag[3] = 0;
+	for( i = 0; i < len; ++i )
+	{
+		df = fabs( sc_list[i] - mean );
+
+		mag[0] += fabs( sc_list[i] );
+		mag[1] += df * df;
+		mag[2] += df * df * df;
+		mag[3] += df * df * df * df;
+	}
+
+	sc_same( "min", len, shape, min, vmin );
+	sc_same( "max", len, shape, max, vmax );
+	sc_close( "sum", len, shape, sum, vsum, mag[0] );
+
+	sc_moments( len, mean, m, m + 1, m + 2 );
+	maths_simd_moments( sc_list, len, mean, v, v + 1, v + 2 );
+
+	sc_close( "m2", len, shape, m[0], v[0], mag[1] );
+	sc_close( "m3", len, shape, m[1], v[1], mag[2] );
+	sc_close( "m4", len, shape, m[2], v[2], mag[3] );
+}
+
+
+int main( int ac, char **av )
+{
+	int64_t len;
+	int s, r;
+
+	__builtin_cpu_init( );
+
+	if( !__builtin_cpu_supports( "avx2" ) )
+	{
+		printf( "No AVX2 on this cpu, nothing to compare.\n" );
+		return 0;
+	}
+
+	srandom( 42 );
+
+	for( s = 0; s < 4; ++s )
+	{
+		// every length that leaves stragglers, either side of the cutoff
+		for( len = 1; len <= 2 * MATHS_SIMD_MIN + 16; ++len )
+			sc_check( len, s );
+
+		for( r = 0; r < SC_ROUNDS; ++r )
+			sc_check( 1 + ( random( ) % SC_MAX_LEN ), s );
+	}
+
+	printf( "Mismatches:  %d of %ld\n", sc_bad, sc_checks );
+
+	return ( sc_bad ) ? 1 : 0;
+}
@@ -135,7 +135,7 @@ void data_handle_line( HOST *h, char *str, int len )
 
 	++(h->lines);
 
-	val = strtod( str, NULL );
+	val = str_to_dbl( str, NULL );
 	now = _proc->curr_usec;
 
 	rkv_tree_lock( l->tel );
@@ -122,11 +122,12 @@ __attribute__((hot)) static inline int relay_line( HOST *h, RLINE *l, char *line
 
 	// we can handle ministry or statsd format
 	// relies on statsd format not containing a space
-	if( !( s = memchr( line, ' ', len ) )
-	 && !( s = memchr( line, ':', len ) ) )
+	// the structural scan has already found them
+	if( ( l->plen = h->scan->sep[STR_SCAN_SPACE] ) < 0
+	 && ( l->plen = h->scan->sep[STR_SCAN_COLON] ) < 0 )
 		return 1;
 
-	l->plen = s - line;
+	s = line + l->plen;
 	l->sep  = *s;
 	*s = '\0';
 
@@ -193,10 +194,11 @@ __attribute__((hot)) void relay_prefix( HOST *h, char *line, int len )
 // and return the length, if any
 __attribute__((hot)) int relay_parse_buf( HOST *h, IOBUF *b )
 {
+	SCANL lines[STR_SCAN_LINES], *sl;
 	register char *s = b->bf->buf;
-	register char *q;
-	int len, l;
-	char *r;
+	register char *p;
+	register int l;
+	int len, i, n;
 
 	// can't parse without a handler function
 	// and those live on the host object
@@ -205,48 +207,42 @@ __attribute__((hot)) int relay_parse_buf( HOST *h, IOBUF *b )
 
 	len = b->bf->len;
 
-	while( len > 0 )
+	// find the lines, and their separators, in one pass
+	while( len > 0 && ( n = str_scan_lines( s, len, STR_SCAN_FIELD_SEPS, lines, STR_SCAN_LINES ) ) > 0 )
 	{
-		// look for newlines
-		if( !( q = memchr( s, LINE_SEPARATOR, len ) ) )
+		for( i = 0, sl = lines; i < n; ++i, ++sl )
 		{
-			// and we're done, with len > 0
-			break;
-		}
-
-		l = q - s;
-		r = q - 1;
-
-		// stomp on that newline
-		*q++ = '\0';
-
-		// and decrement the remaining length
-		len -= q - s;
-
-		// clean leading \r's
-		if( *s == '\r' )
-		{
-			++s;
-			--l;
-		}
-
-		// get the length
-		// and trailing \r's
-		if( l > 0 && *r == '\r' )
-		{
-			*r-- = '\0';
-			--l;
-		}
-
-		// still got anything?
-		if( l > 0 )
-		{
-			// process that line
-			(*(h->parser))( h, s, l );
+			p = s + sl->off;
+			l = sl->len;
+
+			// stomp on that newline
+			p[l] = '\0';
+
+			// clean leading \r's
+			if( *p == '\r' )
+			{
+				++p;
+				--l;
+				str_scan_shift( sl );
+			}
+
+			// and trailing \r's
+			if( l > 0 && p[l-1] == '\r' )
+				p[--l] = '\0';
+
+			// still got anything?
+			if( l > 0 )
+			{
+				// process that line
+				h->scan = sl;
+				(*(h->parser))( h, p, l );
+			}
 		}
 
-		// and move on
-		s = q;
+		// and move on past the last line
+		l    = lines[n-1].off + lines[n-1].len + 1;
+		s   += l;
+		len -= l;
 	}
 
 	strbuf_keep( b->bf, len );
@@ -73,6 +73,13 @@ void self_report_mtypes( void )
 		bprintf( "mem.%s.free %u",  ms.name, ms.ctrs.fcount );
 		bprintf( "mem.%s.alloc %u", ms.name, ms.ctrs.total );
 		bprintf( "mem.%s.kb %lu",   ms.name, ms.bytes / 1024 );
+
+		if( ms.mag_size )
+		{
+			bprintf( "mem.%s.mag.hits %ld",   ms.name, ms.mag.hits );
+			bprintf( "mem.%s.mag.misses %ld", ms.name, ms.mag.misses );
+			bprintf( "mem.%s.mag.cached %ld", ms.name, ms.mag.cached );
+		}
 	}
 }
 
@@ -80,18 +87,48 @@ void self_report_mtypes( void )
 void self_report_netport( NET_PORT *p, char *name, char *proto, int do_drops )
 {
 	uint64_t diff;
+	char pn[16];
+
+	// reuseport sockets share a port number
+	if( p->sock )
+		snprintf( pn, 16, "%hu_%hu", p->port, p->sock );
+	else
+		snprintf( pn, 16, "%hu", p->port );
 
 	diff = lockless_fetch( &(p->errors)  );
-	bprintf( "network.%s.%s.%hu.errors %lu",  name, proto, p->port, diff );
+	bprintf( "network.%s.%s.%s.errors %lu",  name, proto, pn, diff );
 
 	if( do_drops )
 	{
 		diff = lockless_fetch( &(p->drops)   );
-		bprintf( "network.%s.%s.%hu.drops %lu",   name, proto, p->port, diff );
+		bprintf( "network.%s.%s.%s.drops %lu",   name, proto, pn, diff );
 	}
 
 	diff = lockless_fetch( &(p->accepts) );
-	bprintf( "network.%s.%s.%hu.accepts %lu", name, proto, p->port, diff );
+	bprintf( "network.%s.%s.%s.accepts %lu", name, proto, pn, diff );
+}
+
+
+// batch fill tells us how hard the udp socket is being pushed
+void self_report_udpbatch( NET_PORT *p, char *name )
+{
+	uint64_t batches, rcvd, full;
+	char pn[16];
+	double fill;
+
+	batches = lockless_fetch( &(p->batches) );
+	rcvd    = lockless_fetch( &(p->rcvd)    );
+	full    = lockless_fetch( &(p->bfull)   );
+	fill    = ( batches ) ? (double) rcvd / (double) batches : 0;
+
+	if( p->sock )
+		snprintf( pn, 16, "%hu_%hu", p->port, p->sock );
+	else
+		snprintf( pn, 16, "%hu", p->port );
+
+	bprintf( "network.%s.udp.%s.batches %lu",    name, pn, batches );
+	bprintf( "network.%s.udp.%s.batch_full %lu", name, pn, full );
+	bprintf( "network.%s.udp.%s.batch_fill %.3f", name, pn, fill );
 }
 
 
@@ -111,7 +148,10 @@ void self_report_nettype( NET_TYPE *n )
 
 	if( n->flags & NTYPE_UDP_ENABLED )
 		for( i = 0; i < n->udp_count; ++i )
+		{
 			self_report_netport( n->udp[i], n->name, "udp", drops );
+			self_report_udpbatch( n->udp[i], n->name );
+		}
 }
 
 
@@ -71,13 +71,13 @@ __attribute__((hot)) int filter_host_line( HFILT *hf )
 
 __attribute__((hot)) int filter_parse_buf( HOST *h, IOBUF *b )
 {
+	SCANL lines[STR_SCAN_LINES], *sl;
 	register char *s = b->bf->buf;
-	register char *q;
+	register char *p;
 	register int l;
-	char *r, *p;
+	int len, i, n, pl;
 	HFILT *hf;
 	IOBUF *o;
-	int len;
 
 	if( !h )
 		return 0;
@@ -86,69 +86,59 @@ __attribute__((hot)) int filter_parse_buf( HOST *h, IOBUF *b )
 	o   = h->net->out;
 	len = b->bf->len;
 
-	while( len > 0 )
+	// find the lines, and their separators, in one pass
+	while( len > 0 && ( n = str_scan_lines( s, len, STR_SCAN_FIELD_SEPS, lines, STR_SCAN_LINES ) ) > 0 )
 	{
-		// break by newlines
-		if( !( q = memchr( s, LINE_SEPARATOR, len ) ) )
+		for( i = 0, sl = lines; i < n; ++i, ++sl )
 		{
-			// partial last line
-			// we are done with len > 0
-			break;
-		}
+			p = s + sl->off;
+			l = sl->len;
 
-		l = q - s;
-		r = q;
+			// stomp on that newline
+			p[l] = '\0';
 
-		// stomp on that newline
-		*q++ = '\0';
+			// clean leading \r's
+			if( *p == '\r' )
+			{
+				++p;
+				--l;
+				str_scan_shift( sl );
+			}
 
-		// decrement remaining length
-		len -= q - s;
+			// and trailing \r's
+			if( l > 0 && p[l-1] == '\r' )
+				p[--l] = '\0';
 
-		// clean leading \r's
-		if( *s == '\r' )
-		{
-			++s;
-			--l;
-		}
+			// still got anything?
+			if( l <= 0 )
+				continue;
 
-		// get the length and trailing \r's
-		if( l > 0 && *r == '\r' )
-		{
-			*r = '\0';
-			--l;
-		}
+			// the space, or a colon, for statsd format
+			if( ( pl = sl->sep[STR_SCAN_SPACE] ) < 0
+			 && ( pl = sl->sep[STR_SCAN_COLON] ) < 0 )
+				continue;
 
-		// still got anything?
-		if( l > 0 )
-		{
-			// look for the space, or a colon, for statsd format
-		  	if( !( p = memchr( s, ' ', l ) ) )
-				p = memchr( s, ':', l );
+			strbuf_copymax( hf->path, p, pl );
+			++(h->lines);
 
-			// stomp on the first space
-			if( p )
+			// does it pass muster?
+			if( filter_host_line( hf ) == 0 )
 			{
-				strbuf_copymax( hf->path, s, p - s );
-				++(h->lines);		
-
-				// does it pass muster?
-				if( filter_host_line( hf ) == 0 )
-				{
-					++(h->handled);
+				++(h->handled);
 
-					// and forward that line
-					if( !buf_hasspace( o->bf, l + 1 ) )
-						filter_flush_host( h, 1 );
+				// and forward that line
+				if( !buf_hasspace( o->bf, l + 1 ) )
+					filter_flush_host( h, 1 );
 
-					buf_appends( o->bf, s, l );
-					buf_addchar( o->bf, '\n' );
-				}
+				buf_appends( o->bf, p, l );
+				buf_addchar( o->bf, '\n' );
 			}
 		}
 
-		// and move on
-		s = q;
+		// and move on past the last line
+		l    = lines[n-1].off + lines[n-1].len + 1;
+		s   += l;
+		len -= l;
 	}
 
 	if( b->bf->len > 0 )
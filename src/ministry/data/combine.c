@@ -0,0 +1,220 @@
+/**************************************************************************
+* Copyright 2015 John Denholm                                             *
+*                                                                         *
+* Licensed under the Apache License, Version 2.0 (the "License");         *
+* you may not use this file except in compliance with the License.        *
+* You may obtain a copy of the License at                                 *
+*                                                                         *
+*     http://www.apache.org/licenses/LICENSE-2.0                          *
+*                                                                         *
+* Unless required by applicable law or agreed to in writing, software     *
+* distributed under the License is distributed on an "AS IS" BASIS,       *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.*
+* See the License for the specific language governing permissions and     *
+* limitations under the License.                                          *
+*                                                                         *
+*                                                                         *
+* combine.c - per-host combining of adder and gauge updates               *
+*                                                                         *
+* Updates:                                                                *
+**************************************************************************/
+
+
+#include "local.h"
+
+
+// A host sending many updates to the same adder or gauge paths in one
+// read would otherwise hash, search and lock for every line.  Instead
+// we gather them up in a small table on the host and push each path's
+// result into the shared dhash once, at the end of the buffer.  Nothing
+// is held across buffers, so the stats steal still sees every update
+// in the interval it arrived in.
+
+
+
+// is combining switched on for anything this host can send?
+DCMB *data_combine_create( HOST *h )
+{
+	ST_CFG *adder = NULL, *gauge = NULL;
+	DCMB *dc;
+	int i;
+
+	if( !h->type )
+		return NULL;
+
+	for( i = 0; i < DATA_TYPE_MAX; ++i )
+		if( data_type_defns[i].nt == h->type )
+			break;
+
+	switch( i )
+	{
+		case DATA_TYPE_ADDER:
+			adder = ctl->stats->adder;
+			break;
+		case DATA_TYPE_GAUGE:
+			gauge = ctl->stats->gauge;
+			break;
+		case DATA_TYPE_COMPAT:
+			adder = ctl->stats->adder;
+			gauge = ctl->stats->gauge;
+			break;
+		default:
+			return NULL;
+	}
+
+	if( adder && !adder->combine )
+		adder = NULL;
+	if( gauge && !gauge->combine )
+		gauge = NULL;
+
+	if( !adder && !gauge )
+		return NULL;
+
+	dc        = (DCMB *) allocz( sizeof( DCMB ) );
+	dc->adder = adder;
+	dc->gauge = gauge;
+
+	return dc;
+}
+
+
+void data_combine_free( HOST *h )
+{
+	if( h->data )
+	{
+		free( h->data );
+		h->data = NULL;
+	}
+}
+
+
+
+// push everything we gathered into the dhash structures
+__attribute__((hot)) void data_combine_flush( DCMB *dc )
+{
+	DCENT *e;
+	DHASH *d;
+	int i;
+
+	for( i = 0; i < dc->ucount; ++i )
+	{
+		e = dc->ents + dc->used[i];
+		d = e->d;
+
+		if( e->cfg == dc->gauge )
+		{
+			lock_gauge( d );
+
+			if( e->set )
+				dval_set( &(d->in), e->val, e->count );
+			else
+				dval_add( &(d->in), e->val, e->count );
+
+			unlock_gauge( d );
+		}
+		else
+		{
+			lock_adder( d );
+
+			dval_add( &(d->in), e->val, e->count );
+
+			unlock_adder( d );
+		}
+
+		data_dirty( d );
+
+		memset( e, 0, sizeof( DCENT ) );
+	}
+
+	dc->ucount = 0;
+}
+
+
+
+__attribute__((hot)) static inline DCENT *data_combine_find( DCMB *dc, ST_CFG *c, const char *path, int len )
+{
+	uint64_t hval;
+	DCENT *e;
+	int i, j;
+
+	hval = data_path_hash_wrap( path, len );
+
+	for( i = 0; i < DATA_COMBINE_SIZE; ++i )
+	{
+		j = ( hval + i ) & DATA_COMBINE_MASK;
+		e = dc->ents + j;
+
+		if( !e->d )
+		{
+			// keep the table sparse
+			if( dc->ucount >= DATA_COMBINE_FULL )
+			{
+				data_combine_flush( dc );
+				return data_combine_find( dc, c, path, len );
+			}
+
+			e->d    = data_get_dhash_hval( path, len, c, hval );
+			e->cfg  = c;
+			e->hval = hval;
+
+			dc->used[dc->ucount++] = j;
+			return e;
+		}
+
+		if( e->hval == hval
+		 && e->cfg  == c
+		 && e->d->len == len
+		 && !memcmp( e->d->path, path, len ) )
+			return e;
+	}
+
+	// can't happen while we flush at the full mark
+	return NULL;
+}
+
+
+
+__attribute__((hot)) void data_combine_adder( DCMB *dc, const char *path, int len, const char *dat )
+{
+	DCENT *e;
+
+	e = data_combine_find( dc, dc->adder, path, len );
+
+	e->val += str_to_dbl( dat, NULL );
+	++(e->count);
+}
+
+
+__attribute__((hot)) void data_combine_gauge( DCMB *dc, const char *path, int len, const char *dat )
+{
+	DCENT *e;
+	double v;
+	char op;
+
+	// gauges can have relative changes
+	if( *dat == '+' || *dat == '-' )
+		op = *dat++;
+	else
+		op = '\0';
+
+	v = str_to_dbl( dat, NULL );
+	e = data_combine_find( dc, dc->gauge, path, len );
+
+	// a set discards anything before it
+	switch( op )
+	{
+		case '+':
+			e->val += v;
+			break;
+		case '-':
+			e->val -= v;
+			break;
+		default:
+			e->val = v;
+			e->set = 1;
+			break;
+	}
+
+	++(e->count);
+}
+
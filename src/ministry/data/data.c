@@ -26,12 +26,13 @@
 
 
 // break up ministry type line
-__attribute__((hot)) static inline int __data_line_ministry_check( char *line, int len, char **end )
+// the structural scan has already found the space for us
+__attribute__((hot)) static inline int __data_line_ministry_check( char *line, int len, SCANL *sl, char **end )
 {
 	register char *sp;
 	int plen;
 
-	if( !( sp = memchr( line, FIELD_SEPARATOR, len ) ) )
+	if( ( plen = sl->sep[STR_SCAN_SPACE] ) < 0 )
 	{
 		// allow keepalive lines
 		if( len == 9 && !memcmp( line, "keepalive", 9 ) )
@@ -39,7 +40,7 @@ __attribute__((hot)) static inline int __data_line_ministry_check( char *line, i
 		return -1;
 	}
 
-	plen  = sp - line;
+	sp    = line + plen;
 	*sp++ = '\0';
 
 	if( !plen || !*sp )
@@ -52,13 +53,14 @@ __attribute__((hot)) static inline int __data_line_ministry_check( char *line, i
 
 
 // break up a statsd type line
-__attribute__((hot)) static inline int __data_line_compat_check( char *line, int len, char **dat, char **tp )
+// the structural scan has already found the colon and pipe
+__attribute__((hot)) static inline int __data_line_compat_check( char *line, int len, SCANL *sl, char **dat, char **tp )
 {
 	register char *cl;
 	char *vb;
 	int plen;
 
-	if( !( cl = memchr( line, ':', len ) ) )
+	if( ( plen = sl->sep[STR_SCAN_COLON] ) < 0 )
 	{
 		// allow keepalive lines
 		if( len == 9 && !memcmp( line, "keepalive", 9 ) )
@@ -66,7 +68,7 @@ __attribute__((hot)) static inline int __data_line_compat_check( char *line, int
 		return -1;
 	}
 
-	plen  = cl - line;
+	cl    = line + plen;
 	*cl++ = '\0';
 
 	if( !plen || !*cl )
@@ -75,7 +77,10 @@ __attribute__((hot)) static inline int __data_line_compat_check( char *line, int
 	*dat = cl;
 	len -= plen + 1;
 
-	if( !( vb = memchr( cl, '|', len ) ) )
+	// a pipe in the path means we must look again
+	if( sl->sep[STR_SCAN_PIPE] > plen )
+		vb = line + sl->sep[STR_SCAN_PIPE];
+	else if( sl->sep[STR_SCAN_PIPE] < 0 || !( vb = memchr( cl, '|', len ) ) )
 		return -1;
 
 	*vb++ = '\0';
@@ -86,18 +91,24 @@ __attribute__((hot)) static inline int __data_line_compat_check( char *line, int
 
 
 // dispatch a statsd line based on type
-__attribute__((hot)) static inline int __data_line_compat_dispatch( char *path, int len, char *data, char type )
+__attribute__((hot)) static inline int __data_line_compat_dispatch( DCMB *dc, char *path, int len, char *data, char type )
 {
 	switch( type )
 	{
 		case 'c':
-			data_point_adder( path, len, data );
+			if( dc && dc->adder )
+				data_combine_adder( dc, path, len, data );
+			else
+				data_point_adder( path, len, data );
 			break;
 		case 'm':
 			data_point_stats( path, len, data );
 			break;
 		case 'g':
-			data_point_gauge( path, len, data );
+			if( dc && dc->gauge )
+				data_combine_gauge( dc, path, len, data );
+			else
+				data_point_gauge( path, len, data );
 			break;
 		default:
 			return -1;
@@ -108,6 +119,21 @@ __attribute__((hot)) static inline int __data_line_compat_dispatch( char *path,
 
 
 
+// hand a ministry line to the type handler, or the combining table
+__attribute__((hot)) static inline void __data_line_handle( HOST *h, char *path, int len, char *dat )
+{
+	DCMB *dc;
+
+	if( !( dc = (DCMB *) h->data ) )
+		(*(h->handler))( path, len, dat );
+	else if( dc->adder )
+		data_combine_adder( dc, path, len, dat );
+	else
+		data_combine_gauge( dc, path, len, dat );
+}
+
+
+
 // support the statsd format but adding a prefix
 // path:<val>|<c or ms>
 __attribute__((hot)) void data_line_com_prefix( HOST *h, char *line, int len )
@@ -115,7 +141,7 @@ __attribute__((hot)) void data_line_com_prefix( HOST *h, char *line, int len )
 	char *data = NULL, *type = NULL;
 	int plen;
 
-	if( ( plen = __data_line_compat_check( line, len, &data, &type ) ) < 0 || plen > h->lmax )
+	if( ( plen = __data_line_compat_check( line, len, h->scan, &data, &type ) ) < 0 || plen > h->lmax )
 	{
 		++(h->invalid);
 		return;
@@ -129,7 +155,7 @@ __attribute__((hot)) void data_line_com_prefix( HOST *h, char *line, int len )
 	plen += h->plen;
 	h->ltarget[plen] = '\0';
 
-	if( __data_line_compat_dispatch( h->workbuf, plen, data, *type ) < 0 )
+	if( __data_line_compat_dispatch( (DCMB *) h->data, h->workbuf, plen, data, *type ) < 0 )
 		++(h->invalid);
 	else
 		++(h->lines);
@@ -144,7 +170,7 @@ __attribute__((hot)) void data_line_compat( HOST *h, char *line, int len )
 	char *data = NULL, *type = NULL;
 	int plen;
 
-	if( ( plen = __data_line_compat_check( line, len, &data, &type ) ) < 0 )
+	if( ( plen = __data_line_compat_check( line, len, h->scan, &data, &type ) ) < 0 )
 	{
 		++(h->invalid);
 		return;
@@ -153,7 +179,7 @@ __attribute__((hot)) void data_line_compat( HOST *h, char *line, int len )
 	if( !plen )
 		return;  // probably a keepalive
 
-	if( __data_line_compat_dispatch( line, plen, data, *type ) < 0 )
+	if( __data_line_compat_dispatch( (DCMB *) h->data, line, plen, data, *type ) < 0 )
 		++(h->invalid);
 	else
 		++(h->lines);
@@ -166,7 +192,7 @@ __attribute__((hot)) void data_line_min_prefix( HOST *h, char *line, int len )
 	char *ep = NULL;
 	int plen;
 
-	if( ( plen = __data_line_ministry_check( line, len, &ep ) ) < 0 || plen > h->lmax )
+	if( ( plen = __data_line_ministry_check( line, len, h->scan, &ep ) ) < 0 || plen > h->lmax )
 	{
 		++(h->invalid);
 		return;
@@ -184,7 +210,7 @@ __attribute__((hot)) void data_line_min_prefix( HOST *h, char *line, int len )
 	h->workbuf[plen] = '\0';
 
 	// and deal with it
-	(*(h->handler))( h->workbuf, plen, ep );
+	__data_line_handle( h, h->workbuf, plen, ep );
 }
 
 
@@ -195,7 +221,7 @@ __attribute__((hot)) void data_line_ministry( HOST *h, char *line, int len )
 	char *ep = NULL;
 	int plen;
 
-	if( ( plen = __data_line_ministry_check( line, len, &ep ) ) < 0 )
+	if( ( plen = __data_line_ministry_check( line, len, h->scan, &ep ) ) < 0 )
 	{
 		++(h->invalid);
 		return;
@@ -208,7 +234,7 @@ __attribute__((hot)) void data_line_ministry( HOST *h, char *line, int len )
 	++(h->lines);
 
 	// and put that in
-	(*(h->handler))( line, plen, ep );
+	__data_line_handle( h, line, plen, ep );
 }
 
 
@@ -221,11 +247,11 @@ __attribute__((hot)) void data_line_ministry( HOST *h, char *line, int len )
 // and return the length, if any
 __attribute__((hot)) int data_parse_buf( HOST *h, IOBUF *b )
 {
+	SCANL lines[STR_SCAN_LINES], *sl;
 	register char *s = b->bf->buf;
-	register char *q;
+	register char *p;
 	register int l;
-	int len;
-	char *r;
+	int len, i, n;
 
 	// can't parse without a handler function
 	// and those live on the host object
@@ -234,51 +260,55 @@ __attribute__((hot)) int data_parse_buf( HOST *h, IOBUF *b )
 
 	len = b->bf->len;
 
-	while( len > 0 )
+	// are we combining updates for this host?  only ask once
+	if( !h->data_init )
 	{
-		// look for newlines
-		if( !( q = memchr( s, LINE_SEPARATOR, len ) ) )
-		{
-			// partial last line
-			// and we're done, with len > 0
-			break;
-		}
-
-		l = q - s;
-		r = q - 1;
-
-		// stomp on that newline
-		*q++ = '\0';
-
-		// and decrement the remaining length
-		len -= q - s;
-
-		// clean leading \r's
-		if( *s == '\r' )
-		{
-			++s;
-			--l;
-		}
-
-		// get the length
-		// and trailing \r's
-		if( l > 0 && *r == '\r' )
-		{
-			*r = '\0';
-			--l;
-		}
+		h->data      = data_combine_create( h );
+		h->data_init = 1;
+	}
 
-		// still got anything?
-		if( l > 0 )
+	// find the lines, and their separators, in one pass
+	while( len > 0 && ( n = str_scan_lines( s, len, STR_SCAN_FIELD_SEPS, lines, STR_SCAN_LINES ) ) > 0 )
+	{
+		for( i = 0, sl = lines; i < n; ++i, ++sl )
 		{
-			// process that line
-			(*(h->parser))( h, s, l );
+			p = s + sl->off;
+			l = sl->len;
+
+			// stomp on that newline
+			p[l] = '\0';
+
+			// clean leading \r's
+			if( *p == '\r' )
+			{
+				++p;
+				--l;
+				str_scan_shift( sl );
+			}
+
+			// and trailing \r's
+			if( l > 0 && p[l-1] == '\r' )
+				p[--l] = '\0';
+
+			// still got anything?
+			if( l > 0 )
+			{
+				// process that line
+				h->scan = sl;
+				(*(h->parser))( h, p, l );
+			}
 		}
 
-		// and move on
-		s = q;
+		// and move on past the last line
+		l    = lines[n-1].off + lines[n-1].len + 1;
+		s   += l;
+		len -= l;
 	}
 
+	// and push any combined updates into the shared data
+	if( h->data )
+		data_combine_flush( (DCMB *) h->data );
+
 	strbuf_keep( b->bf, len );
 	return len;
 }
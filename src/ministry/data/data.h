@@ -30,10 +30,32 @@
 
 // rounds the structure to 16k with a spare space
 #define PTLIST_SIZE				2046
+// and the smaller classes to 1k and 128 bytes
+#define PTLIST_MED_SIZE			126
+#define PTLIST_SML_SIZE			14
+
+// per-host combining table
+#define DATA_COMBINE_SIZE		128
+#define DATA_COMBINE_MASK		( DATA_COMBINE_SIZE - 1 )
+#define DATA_COMBINE_FULL		( ( 3 * DATA_COMBINE_SIZE ) / 4 )
+
+// hash table growth
+#define DATA_HASH_MIGRATE		16384		// old buckets each stats thread moves per pass
+#define DATA_HASH_MAX_SIZE		0x10000000UL
+
+// lookup index
+#define DATA_INDEX_MIN			64
+#define DATA_INDEX_TOMB			( (DHASH *) 0x1 )
+
+// tags are never 0 - that marks an empty slot
+#define data_index_tag( _m )		( (uint32_t) ( (_m) >> 32 ) | 0x1 )
 
 #define DHASH_CHECK_MOMENTS		0x01
 #define DHASH_CHECK_MODE		0x02
 #define DHASH_CHECK_PREDICT		0x04
+#define DHASH_CHECK_SKETCH		0x08
+#define DHASH_CHECK_COMPACT		0x10
+#define DHASH_CHECK_SYNTH		0x20
 
 
 enum data_conn_type
@@ -67,6 +89,27 @@ struct data_type_params
 extern DTYPE data_type_defns[];
 
 
+struct data_combine_entry
+{
+	DHASH			*	d;
+	ST_CFG			*	cfg;
+	uint64_t			hval;
+	double				val;
+	int64_t				count;
+	int8_t				set;
+};
+
+
+struct data_combine
+{
+	ST_CFG			*	adder;
+	ST_CFG			*	gauge;
+	int					ucount;
+	uint8_t				used[DATA_COMBINE_SIZE];
+	DCENT				ents[DATA_COMBINE_SIZE];
+};
+
+
 #define dp_set( _dp, t, v )			_dp.ts = t; _dp.val = v
 #define dp_get_t( _dp )				_dp.ts
 #define dp_get_v( _dp )				_dp.val
@@ -79,6 +122,9 @@ extern DTYPE data_type_defns[];
 #define dhash_do_moments( _d )		( _d->checks & DHASH_CHECK_MOMENTS )
 #define dhash_do_mode( _d )			( _d->checks & DHASH_CHECK_MODE )
 #define dhash_do_predict( _d )		( ( _d->checks & DHASH_CHECK_PREDICT ) && _d->predict )
+#define dhash_do_sketch( _d )		( _d->checks & DHASH_CHECK_SKETCH )
+#define dhash_do_compact( _d )		( _d->checks & DHASH_CHECK_COMPACT )
+#define dhash_is_synth( _d )		( _d->checks & DHASH_CHECK_SYNTH )
 
 
 
@@ -89,26 +135,151 @@ struct data_histogram	// size 16
 };
 
 
-struct points_list		// 8192
+// quiet paths don't need 16k each, so points come in size
+// classes, and a path grows into the bigger ones as it gets busy
+enum ptlist_classes
+{
+	PTLIST_CLASS_SML = 0,
+	PTLIST_CLASS_MED,
+	PTLIST_CLASS_BIG,
+	PTLIST_CLASSES
+};
+
+// compact paths keep floats in vals, so twice as many
+struct points_list		// 16 + 8 * size
 {
 	PTLIST			*	next;
-	int64_t				count;
-	double				vals[PTLIST_SIZE];
+	int32_t				count;
+	int16_t				size;
+	int8_t				cls;
+	uint8_t				rounded;	// a value didn't fit a float exactly
+	double				vals[];
 };
 
 
-struct data_hash_vals	// size 40
+// A stats path past the point cap keeps a sample of its points,
+// but the count, sum and ends are still exact
+struct data_reservoir
+{
+	double				total;
+	double				comp;		// kahan compensation
+	double				min;
+	double				max;
+	double				w;			// algorithm L's weight
+	int64_t				next;		// the next point we keep
+	int64_t				kept;		// size of the sample
+};
+
+
+struct data_hash_vals	// size 56
 {
 	PTLIST			*	points;
+	SKETCH			*	sketch;		// instead of points, for some stats
+	DRES			*	res;		// only once past the point cap
 	DHIST				hist;
 	double				total;
 	int64_t				count;
 };
 
 
-struct data_hash_entry	// size 104
+// Adder and gauge values.  With LOCK_DHASH_ATOMIC these are updated
+// without the dhash lock - count with fetch-add, total with a compare
+// and swap - and stolen with atomic exchanges.  Total and count are
+// still separate words, so an update racing the steal may land its
+// value in one interval and its count in the next, but nothing is lost.
+#ifdef LOCK_DHASH_ATOMIC
+
+static inline void dval_add( DVAL *v, double x, int64_t n )
+{
+	double o, t;
+
+	__atomic_load( &(v->total), &o, __ATOMIC_RELAXED );
+	do
+	{
+		t = o + x;
+	}
+	while( !__atomic_compare_exchange( &(v->total), &o, &t, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) );
+
+	__atomic_fetch_add( &(v->count), n, __ATOMIC_RELEASE );
+}
+
+static inline void dval_set( DVAL *v, double x, int64_t n )
+{
+	__atomic_store( &(v->total), &x, __ATOMIC_RELAXED );
+	__atomic_fetch_add( &(v->count), n, __ATOMIC_RELEASE );
+}
+
+static inline int64_t dval_count( DVAL *v )
+{
+	return __atomic_load_n( &(v->count), __ATOMIC_ACQUIRE );
+}
+
+// take everything, leaving zeros behind
+static inline void dval_steal( DVAL *from, DVAL *to )
+{
+	double z = 0;
+
+	to->count = __atomic_exchange_n( &(from->count), 0, __ATOMIC_ACQUIRE );
+	__atomic_exchange( &(from->total), &z, &(to->total), __ATOMIC_RELAXED );
+}
+
+// take the count, but gauges keep their value
+static inline void dval_steal_count( DVAL *from, DVAL *to )
+{
+	to->count = __atomic_exchange_n( &(from->count), 0, __ATOMIC_ACQUIRE );
+	__atomic_load( &(from->total), &(to->total), __ATOMIC_RELAXED );
+}
+
+#else
+
+static inline void dval_add( DVAL *v, double x, int64_t n )
+{
+	v->total += x;
+	v->count += n;
+}
+
+static inline void dval_set( DVAL *v, double x, int64_t n )
+{
+	v->total  = x;
+	v->count += n;
+}
+
+static inline int64_t dval_count( DVAL *v )
+{
+	return v->count;
+}
+
+static inline void dval_steal( DVAL *from, DVAL *to )
+{
+	to->total   = from->total;
+	to->count   = from->count;
+	from->total = 0;
+	from->count = 0;
+}
+
+static inline void dval_steal_count( DVAL *from, DVAL *to )
+{
+	to->total   = from->total;
+	to->count   = from->count;
+	from->count = 0;
+}
+
+#endif
+
+
+
+// a rendered output name, cached on the path
+struct data_name
+{
+	char			*	str;
+	uint32_t			len;
+};
+
+
+struct data_hash_entry	// size 168
 {
 	DHASH			*	next;
+	DHASH			*	dnext;	// dirty list, owned by the stats thread
 	char			*	path;	// full path
 	char			*	base;	// copy with the base part
 	char			*	tags;	// does not hold memory - points into path
@@ -122,6 +293,12 @@ struct data_hash_entry	// size 104
 	// predictor structure, present or absent
 	PRED			*	predict;
 
+	// values published for synthetics, if any read us
+	SYNVAL			*	synv;
+
+	// output names, built as they are needed
+	DNAME			*	names;
+
 	dhash_lock_t	*	lock;
 
 	uint16_t			sz;		// alloc'd size
@@ -136,14 +313,68 @@ struct data_hash_entry	// size 104
 	uint8_t				type;
 	uint8_t				checks;
 	int32_t				empty;
+	uint32_t			seen;	// stats pass that last had data
+	uint8_t				dirty;	// on a dirty list
+	uint16_t			ncount;	// names slots
 };
 
 
+struct data_hash_index
+{
+	uint32_t		*	tags;
+	DHASH			**	ptrs;
+	uint64_t			size;
+	uint64_t			mask;
+	uint64_t			used;	// slots ever filled, tombstones too
+};
+
+
+
 uint64_t data_path_hash_wrap( const char *path, int len );
 
 DHASH *data_locate( const char *path, int len, int type );
 DHASH *data_find_dhash( const char *path, int len, ST_CFG *c );
 DHASH *data_get_dhash( const char *path, int len, ST_CFG *c );
+DHASH *data_get_dhash_hval( const char *path, int len, ST_CFG *c, uint64_t hval );
+
+// online resizing of the hash tables
+void data_hash_grow( ST_CFG *c );
+void data_hash_migrate( ST_CFG *c, uint64_t i );
+void data_hash_grow_done( ST_CFG *c );
+void data_hash_lock_all( void );
+void data_hash_unlock_all( void );
+
+// dirty lists of paths with data
+void data_dirty_push( DHASH *d );
+
+// the first update after a steal puts a path on its thread's
+// dirty list; the check is seq-cst to pair with the clear on steal
+static inline void data_dirty( DHASH *d )
+{
+	if( !__atomic_load_n( &(d->dirty), __ATOMIC_SEQ_CST )
+	 && !__atomic_exchange_n( &(d->dirty), 1, __ATOMIC_SEQ_CST ) )
+		data_dirty_push( d );
+}
+
+// cleared before stealing, so anything after the steal marks it again
+static inline void data_dirty_clear( DHASH *d )
+{
+	__atomic_store_n( &(d->dirty), 0, __ATOMIC_SEQ_CST );
+}
+
+// open-addressed lookup index
+DHASH *data_index_find( DHIDX *x, uint64_t hval, const char *path, int len );
+void data_index_insert( DHIDX *x, DHASH *d );
+void data_index_remove( DHIDX *x, DHASH *d );
+void data_index_rebuild( ST_CFG *c );
+void data_index_init( ST_CFG *c );
+
+// combining of adder and gauge updates on a host
+DCMB *data_combine_create( HOST *h );
+void data_combine_free( HOST *h );
+void data_combine_flush( DCMB *dc );
+void data_combine_adder( DCMB *dc, const char *path, int len, const char *dat );
+void data_combine_gauge( DCMB *dc, const char *path, int len, const char *dat );
 
 
 dupd_fn data_update_stats;
@@ -127,18 +127,33 @@ void data_keep_stats( ST_CFG *c )
 
 
 
-__attribute__((hot)) static inline DHASH *data_find_path( DHASH *list, uint64_t hval, const char *path, int len )
+// Lookups are lock-free, through the index (see index.c).  A miss
+// here sends us to the locked create path, which checks again.
+__attribute__((hot)) static inline DHASH *data_find_any( ST_CFG *c, uint64_t hval, const char *path, int len )
 {
-	register DHASH *h;
+	return data_index_find( __atomic_load_n( &(c->index), __ATOMIC_ACQUIRE ), hval, path, len );
+}
 
-	for( h = list; h; h = h->next )
-		if( h->sum == hval
-		 && h->valid
-		 && h->len == len
-		 && !memcmp( h->path, path, len ) )
-			break;
 
-	return h;
+
+// Each stats thread has a list of the paths that have had data since
+// its last steal, so it never walks the idle ones.  Pushes are a
+// lock-free stack; the thread only ever takes the whole list, so
+// there is no ABA to worry about.  Ownership follows the buckets.
+__attribute__((hot)) void data_dirty_push( DHASH *d )
+{
+	ST_CFG *c = data_type_defns[d->type].stc;
+	ST_THR *t;
+	DHASH *h;
+
+	t = c->ctls + ( ( d->sum % c->hbase ) % c->threads );
+	h = __atomic_load_n( &(t->dirty), __ATOMIC_RELAXED );
+
+	do
+	{
+		d->dnext = h;
+	}
+	while( !__atomic_compare_exchange_n( &(t->dirty), &h, d, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED ) );
 }
 
 
@@ -178,7 +193,7 @@ DHASH *data_locate( const char *path, int len, int type )
 			return NULL;
 	}
 
-	return data_find_path( c->data[hval % c->hsize], hval, path, len );
+	return data_find_any( c, hval, path, len );
 }
 
 
@@ -222,6 +237,21 @@ __attribute__((hot)) static inline void data_get_dhash_extras( DHASH *d )
 				//debug( "Path %s will get mode processing.", d->path );
 				d->checks |= DHASH_CHECK_MODE;
 			}
+			if( ctl->stats->sketch->enabled
+			 && regex_list_test( d->path, ctl->stats->sketch->rgx ) == REGEX_MATCH )
+			{
+				//debug( "Path %s will be sketched.", d->path );
+				d->checks |= DHASH_CHECK_SKETCH;
+				d->in.sketch   = sketch_create( ctl->stats->sketch );
+				d->proc.sketch = sketch_create( ctl->stats->sketch );
+			}
+			// sketches keep no points to be compact
+			else if( ctl->stats->compact->enabled
+			 && regex_list_test( d->path, ctl->stats->compact->rgx ) == REGEX_MATCH )
+			{
+				//debug( "Path %s will keep compact points.", d->path );
+				d->checks |= DHASH_CHECK_COMPACT;
+			}
 			data_get_tags( d );
 			break;
 
@@ -271,17 +301,17 @@ __attribute__((hot)) static inline void data_get_dhash_extras( DHASH *d )
 
 DHASH *data_find_dhash( const char *path, int len, ST_CFG *c )
 {
-	uint64_t hval, idx;
+	uint64_t hval;
 
 	hval = data_path_hash( (char *) path, len );
-	idx  = hval % c->hsize;
 
-	return data_find_path( c->data[idx], hval, (char *) path, len );
+	return data_find_any( c, hval, (char *) path, len );
 }
 
 
-__attribute__((hot)) DHASH *data_create_dhash( const char *path, int len, ST_CFG *c, uint64_t hval, uint64_t idx )
+__attribute__((hot)) DHASH *data_create_dhash( const char *path, int len, ST_CFG *c, uint64_t hval )
 {
+	uint64_t idx, lk;
 	DHASH *n, *e;
 
 	n = mem_new_dhash( path, len );
@@ -295,16 +325,30 @@ __attribute__((hot)) DHASH *data_create_dhash( const char *path, int len, ST_CFG
 	n->sum   = hval;
 	n->type  = c->dtype;
 
-	lock_table( idx );
+	// getting full?  This takes every table lock
+	if( c->index->used > ( c->index->size >> 1 ) )
+		data_index_rebuild( c );
+
+	// the lock is chosen by the starting table size, so it covers
+	// this path's bucket in both tables during a resize
+	lk = hval % c->hbase;
 
-	if( !( e = data_find_path( c->data[idx], hval, path, len ) ) )
+	lock_table( lk );
+
+	// and neither the tables nor the index can change while we hold
+	// it, and nobody else can be inserting this path
+	if( !( e = data_index_find( c->index, hval, path, len ) ) )
 	{
+		idx = hval % c->hsize;
+
 		n->next = c->data[idx];
 		n->valid = 1;
 		c->data[idx] = n;
+
+		data_index_insert( c->index, n );
 	}
 
-	unlock_table( idx );
+	unlock_table( lk );
 
 	// someone else made it in-between
 	// so free the new one and return that one
@@ -326,18 +370,151 @@ __attribute__((hot)) DHASH *data_create_dhash( const char *path, int len, ST_CFG
 
 
 
+// for callers who already have the hash value
+__attribute__((hot)) DHASH *data_get_dhash_hval( const char *path, int len, ST_CFG *c, uint64_t hval )
+{
+	DHASH *d;
+
+	if( ( d = data_find_any( c, hval, path, len ) ) )
+		return d;
+
+	return data_create_dhash( path, len, c, hval );
+}
+
+
 __attribute__((hot)) DHASH *data_get_dhash( const char *path, int len, ST_CFG *c )
 {
-	uint64_t hval, idx;
+	uint64_t hval;
 	DHASH *d;
 
 	hval = data_path_hash( path, len );
-	idx  = hval % c->hsize;
 
-	if( ( d = data_find_path( c->data[idx], hval, path, len ) ) )
+	if( ( d = data_find_any( c, hval, path, len ) ) )
 		return d;
 
 	/* try again, under lock this time, assuming we will create it */
-	return data_create_dhash( path, len, c, hval, idx );
+	return data_create_dhash( path, len, c, hval );
+}
+
+
+
+/*
+ * Online resizing
+ *
+ * When a table gets crowded we double it, and the stats threads move
+ * the old buckets across a batch at a time, at the start of each pass.
+ * Because the new size is always a multiple of the starting size, a
+ * path's bucket modulo the starting size never changes.  That picks
+ * both its table lock and its stats thread, so a bucket is only ever
+ * moved by the thread that owns it, under the lock that covers every
+ * create of a path that could land in it.
+ *
+ * Lookups go through the index, which holds dhash pointers and so
+ * doesn't care where a dhash is chained.  The old table is kept until
+ * the next resize finishes, as a stats thread may still have its
+ * buckets on its list.
+ */
+
+void data_hash_lock_all( void )
+{
+	int i;
+
+	for( i = 0; i < HASHT_MUTEX_COUNT; ++i )
+		lock_table( i );
+}
+
+void data_hash_unlock_all( void )
+{
+	int i;
+
+	for( i = 0; i < HASHT_MUTEX_COUNT; ++i )
+		unlock_table( i );
+}
+
+
+
+void data_hash_grow( ST_CFG *c )
+{
+	uint64_t osz, sz;
+	DHASH **n;
+
+	// gc might be walking the table - try again next time
+	if( trylock_hash_cfg( c ) )
+		return;
+
+	osz = c->hsize;
+	sz  = osz * 2;
+
+	if( !( n = (DHASH **) allocz( sz * sizeof( DHASH * ) ) ) )
+	{
+		unlock_hash_cfg( c );
+		err( "Could not allocate a new %s hash table of %lu buckets.", c->name, sz );
+		return;
+	}
+
+	data_hash_lock_all( );
+
+	c->odata  = c->data;
+	c->ohsize = osz;
+	c->data   = n;
+	c->hsize  = sz;
+	c->mdone  = 0;
+	++(c->resizes);
+
+	// and tell the stats threads to start moving
+	__atomic_add_fetch( &(c->hgen), 1, __ATOMIC_RELEASE );
+
+	data_hash_unlock_all( );
+
+	unlock_hash_cfg( c );
+
+	info( "Growing the %s hash table from %lu to %lu buckets (%d paths).", c->name, osz, sz, c->dcurr );
+}
+
+
+
+// move one old bucket into the new table - the caller owns it
+__attribute__((hot)) void data_hash_migrate( ST_CFG *c, uint64_t i )
+{
+	DHASH *d, *next;
+	uint64_t j;
+
+	lock_table( i % c->hbase );
+
+	for( d = c->odata[i]; d; d = next )
+	{
+		next       = d->next;
+		j          = d->sum % c->hsize;
+		d->next    = c->data[j];
+		c->data[j] = d;
+	}
+
+	c->odata[i] = NULL;
+
+	unlock_table( i % c->hbase );
+}
+
+
+
+// every thread has moved its buckets
+void data_hash_grow_done( ST_CFG *c )
+{
+	DHASH **r;
+
+	data_hash_lock_all( );
+
+	r          = c->retired;
+	c->retired = c->odata;
+	c->odata   = NULL;
+	c->ohsize  = 0;
+
+	__atomic_add_fetch( &(c->hgen), 1, __ATOMIC_RELEASE );
+
+	data_hash_unlock_all( );
+
+	if( r )
+		free( r );
+
+	info( "Finished growing the %s hash table to %lu buckets.", c->name, c->hsize );
 }
 
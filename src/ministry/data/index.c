@@ -0,0 +1,209 @@
+/**************************************************************************
+* Copyright 2015 John Denholm                                             *
+*                                                                         *
+* Licensed under the Apache License, Version 2.0 (the "License");         *
+* you may not use this file except in compliance with the License.        *
+* You may obtain a copy of the License at                                 *
+*                                                                         *
+*     http://www.apache.org/licenses/LICENSE-2.0                          *
+*                                                                         *
+* Unless required by applicable law or agreed to in writing, software     *
+* distributed under the License is distributed on an "AS IS" BASIS,       *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.*
+* See the License for the specific language governing permissions and     *
+* limitations under the License.                                          *
+*                                                                         *
+*                                                                         *
+* index.c - open-addressed lookup index over the dhash chains             *
+*                                                                         *
+* Updates:                                                                *
+**************************************************************************/
+
+
+#include "local.h"
+
+
+/*
+ * Walking a hash chain touches a whole dhash struct at every step, and
+ * they are scattered all over memory.  So lookups go through an index
+ * instead:  an array of 32-bit tags, sixteen to a cache line, and a
+ * matching array of dhash pointers, with linear probing.  We only look
+ * at a dhash when its tag matches, so a lookup is usually one line of
+ * tags and one dhash.
+ *
+ * The chains stay as they were - the stats threads and gc walk them.
+ *
+ * Lookups take no locks.  Inserts claim a pointer slot with a compare
+ * and swap, then write the tag, and are made under the table lock for
+ * the path, so one path can never be inserted twice.  A reader that
+ * catches a slot half-written just misses, and the locked create path
+ * sorts it out.  Gc replaces removed entries with a tombstone, which
+ * keeps its tag so probing carries on past it.
+ *
+ * Once more than half the slots have been used we build a new index
+ * from the chains, under every table lock.  The old one is kept until
+ * the next rebuild, for any lookup still reading it.
+ */
+
+
+
+// the path hash does little bit-mixing, and we index by mask
+static inline uint64_t data_index_mix( uint64_t h )
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdUL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53UL;
+	h ^= h >> 33;
+
+	return h;
+}
+
+
+static DHIDX *data_index_create( uint64_t want )
+{
+	DHIDX *x;
+
+	x = (DHIDX *) allocz( sizeof( DHIDX ) );
+
+	for( x->size = DATA_INDEX_MIN; x->size < want; x->size <<= 1 );
+
+	x->mask = x->size - 1;
+	x->tags = (uint32_t *) allocz( x->size * sizeof( uint32_t ) );
+	x->ptrs = (DHASH **)   allocz( x->size * sizeof( DHASH * ) );
+
+	return x;
+}
+
+
+static void data_index_free( DHIDX *x )
+{
+	free( x->tags );
+	free( x->ptrs );
+	free( x );
+}
+
+
+
+__attribute__((hot)) DHASH *data_index_find( DHIDX *x, uint64_t hval, const char *path, int len )
+{
+	uint64_t m, i;
+	uint32_t tag, t;
+	DHASH *d;
+
+	m   = data_index_mix( hval );
+	tag = data_index_tag( m );
+
+	for( i = m & x->mask; ( t = __atomic_load_n( x->tags + i, __ATOMIC_ACQUIRE ) ); i = ( i + 1 ) & x->mask )
+		if( t == tag
+		 && ( d = x->ptrs[i] ) != DATA_INDEX_TOMB
+		 && d
+		 && d->sum == hval
+		 && d->valid
+		 && d->len == len
+		 && !memcmp( d->path, path, len ) )
+			return d;
+
+	return NULL;
+}
+
+
+
+// caller holds the table lock for this path
+__attribute__((hot)) void data_index_insert( DHIDX *x, DHASH *d )
+{
+	uint64_t m, i;
+	uint32_t tag;
+	DHASH *p;
+
+	m   = data_index_mix( d->sum );
+	tag = data_index_tag( m );
+
+	for( i = m & x->mask; ; i = ( i + 1 ) & x->mask )
+	{
+		p = __atomic_load_n( x->ptrs + i, __ATOMIC_ACQUIRE );
+
+		if( p && p != DATA_INDEX_TOMB )
+			continue;
+
+		// someone in another lock may beat us to it
+		if( !__atomic_compare_exchange_n( x->ptrs + i, &p, d, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED ) )
+			continue;
+
+		__atomic_store_n( x->tags + i, tag, __ATOMIC_RELEASE );
+
+		if( !p )
+			__atomic_add_fetch( &(x->used), 1, __ATOMIC_RELAXED );
+
+		return;
+	}
+}
+
+
+
+// caller holds the table lock for this path
+void data_index_remove( DHIDX *x, DHASH *d )
+{
+	uint64_t i;
+
+	for( i = data_index_mix( d->sum ) & x->mask; x->tags[i]; i = ( i + 1 ) & x->mask )
+		if( x->ptrs[i] == d )
+		{
+			x->ptrs[i] = DATA_INDEX_TOMB;
+			return;
+		}
+}
+
+
+
+// rebuild from the chains, big enough to stay under a quarter full
+void data_index_rebuild( ST_CFG *c )
+{
+	DHIDX *x, *r;
+	uint64_t i;
+	int64_t n;
+	DHASH *d;
+
+	data_hash_lock_all( );
+
+	// someone else got here first?
+	if( c->index->used <= ( c->index->size >> 1 ) )
+	{
+		data_hash_unlock_all( );
+		return;
+	}
+
+	n = c->dcurr;
+	x = data_index_create( 4 * ( n + 1 ) );
+
+	for( i = 0; i < c->hsize; ++i )
+		for( d = c->data[i]; d; d = d->next )
+			if( d->valid )
+				data_index_insert( x, d );
+
+	// mid-resize, some are still in the old table
+	if( c->odata )
+		for( i = 0; i < c->ohsize; ++i )
+			for( d = c->odata[i]; d; d = d->next )
+				if( d->valid )
+					data_index_insert( x, d );
+
+	r           = c->iretired;
+	c->iretired = c->index;
+	__atomic_store_n( &(c->index), x, __ATOMIC_RELEASE );
+
+	data_hash_unlock_all( );
+
+	if( r )
+		data_index_free( r );
+
+	debug( "Rebuilt the %s index with %lu slots for %ld paths.", c->name, x->size, n );
+}
+
+
+
+void data_index_init( ST_CFG *c )
+{
+	c->index = data_index_create( c->hsize );
+}
+
@@ -88,7 +88,7 @@ int data_parse_json_element( DTYPE *dt, json_object *el )
 						op = *sval++;
 				}
 
-				val = strtod( sval, NULL );
+				val = str_to_dbl( sval, NULL );
 				break;
 
 			case json_type_double:
@@ -29,7 +29,7 @@ __attribute__((hot)) void data_point_histo( const char *path, int len, const cha
 	double v;
 	DHASH *d;
 
-	v = strtod( dat, NULL );
+	v = str_to_dbl( dat, NULL );
 	d = data_get_dhash( path, len, ctl->stats->histo );
 
 	data_update_histo( d, v, '\0' );
@@ -54,7 +54,7 @@ __attribute__((hot)) void data_point_gauge( const char *path, int len, const cha
 	// number, you must first set it to zero.  Don't blame me,
 	// this follows the statsd guide
 	// https://github.com/etsy/statsd/blob/master/docs/metric_types.md
-	v = strtod( dat, NULL );
+	v = str_to_dbl( dat, NULL );
 	d = data_get_dhash( path, len, ctl->stats->gauge );
 
 	data_update_gauge( d, v, op );
@@ -68,7 +68,7 @@ __attribute__((hot)) void data_point_adder( const char *path, int len, const cha
 	double val;
 	DHASH *d;
 
-	val = strtod( dat, NULL );
+	val = str_to_dbl( dat, NULL );
 
 	d = data_get_dhash( path, len, ctl->stats->adder );
 
@@ -76,11 +76,12 @@ __attribute__((hot)) void data_point_adder( const char *path, int len, const cha
 	lock_adder( d );
 
 	// add in that data point
-	d->in.total += val;
-	++(d->in.count);
+	dval_add( &(d->in), val, 1 );
 
 	// and unlock
 	unlock_adder( d );
+
+	data_dirty( d );
 }
 
 
@@ -89,7 +90,7 @@ __attribute__((hot)) void data_point_stats( const char *path, int len, const cha
 	double v;
 	DHASH *d;
 
-	v = strtod( dat, NULL );
+	v = str_to_dbl( dat, NULL );
 	d = data_get_dhash( path, len, ctl->stats->stats );
 
 	data_update_stats( d, v, '\0' );
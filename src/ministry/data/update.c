@@ -24,6 +24,47 @@
 
 
 
+// the first bound with val <= bound, or c->brange for +inf
+__attribute__((hot)) static inline int data_histo_search( ST_HIST *c, double val )
+{
+	const double *b = c->bounds;
+	int n = c->brange, h;
+
+	// halve the range each time, without a branch to mispredict
+	// it's written this way round so that nan goes to +inf
+	while( n > 1 )
+	{
+		h  = n >> 1;
+		b += h * !( val <= b[h - 1] );
+		n -= h;
+	}
+
+	return ( b - c->bounds ) + !( val <= *b );
+}
+
+
+// log-linear buckets come straight from the bits of the double
+__attribute__((hot)) static inline int data_histo_hdr( ST_HIST *c, double val )
+{
+	union { double d; uint64_t u; } v;
+	int64_t k;
+
+	if( !( val > 0 ) )
+		return ( val <= 0 ) ? 0 : c->brange;
+
+	// one below, so a value on an edge goes in the bucket under it
+	v.d = val;
+	k   = (int64_t) ( ( v.u - 1 ) >> c->hshift ) - (int64_t) c->hbase + 1;
+
+	if( k < 0 )
+		return 0;
+	if( k > c->brange )
+		return c->brange;
+
+	return (int) k;
+}
+
+
 __attribute__((hot)) void data_update_histo( DHASH *d, double val, char unused )
 {
 	register int i;
@@ -33,20 +74,28 @@ __attribute__((hot)) void data_update_histo( DHASH *d, double val, char unused )
 	h = &(d->in.hist);
 	c = h->conf;
 
-	// find the right boundary
-	for( i = 0; i < c->brange; ++i )
-		if( val <= c->bounds[i] )
-			break;
-
-	// if we don't find one, i == c->brange
-	// which is the +inf count
+	// find the right boundary - outside the lock
+	// if there isn't one, i == c->brange, which is the +inf count
+	if( c->hdr )
+		i = data_histo_hdr( c, val );
+	else
+		i = data_histo_search( c, val );
 
 	lock_histo( d );
 
+	// gc may have reaped it since we found it
+	if( !h->counts )
+	{
+		unlock_histo( d );
+		return;
+	}
+
 	++(h->counts[i]);
 	++(d->in.count);
 
-	unlock_histo( d ); 
+	unlock_histo( d );
+
+	data_dirty( d );
 }
 
 
@@ -60,20 +109,20 @@ __attribute__((hot)) void data_update_gauge( DHASH *d, double val, char op )
 	switch( op )
 	{
 		case '+':
-			d->in.total += val;
+			dval_add( &(d->in), val, 1 );
 			break;
 		case '-':
-			d->in.total -= val;
+			dval_add( &(d->in), -val, 1 );
 			break;
 		default:
-			d->in.total = val;
+			dval_set( &(d->in), val, 1 );
 			break;
 	}
 
-	++(d->in.count);
-
 	// and unlock
 	unlock_gauge( d );
+
+	data_dirty( d );
 }
 
 
@@ -84,25 +133,161 @@ __attribute__((hot)) void data_update_adder( DHASH *d, double val, char unused )
 	lock_adder( d );
 
 	// add in that data point
-	d->in.total += val;
-	++(d->in.count);
+	dval_add( &(d->in), val, 1 );
 
 	// and unlock
 	unlock_adder( d );
+
+	data_dirty( d );
+}
+
+
+// a uniform random number in (0,1) - never 0, we take logs of it
+static inline double data_res_rand( void )
+{
+	return ( (double) random( ) + 1.0 ) / ( (double) RAND_MAX + 2.0 );
+}
+
+
+// algorithm L - how many points to skip before we keep another
+static inline void data_res_skip( DRES *r )
+{
+	double s = floor( log( data_res_rand( ) ) / log( 1.0 - r->w ) );
+
+	// w only shrinks, and past here we'd never get there anyway
+	r->next += ( s < 1e15 ) ? 1 + (int64_t) s : 1000000000000000LL;
+	r->w    *= exp( log( data_res_rand( ) ) / (double) r->kept );
+}
+
+
+static inline void data_res_add( DRES *r, double v )
+{
+	double y, t;
+
+	if( v < r->min )
+		r->min = v;
+	if( v > r->max )
+		r->max = v;
+
+	y = v - r->comp;
+	t = r->total + y;
+	r->comp  = ( t - r->total ) - y;
+	r->total = t;
+}
+
+
+// the points we already have are the sample so far
+static DRES *data_res_start( DHASH *d, int cpt )
+{
+	PTLIST *p;
+	DRES *r;
+	int32_t i;
+
+	r = (DRES *) allocz( sizeof( DRES ) );
+	r->min = INFINITY;
+	r->max = -INFINITY;
+
+	for( p = d->in.points; p; p = p->next )
+		for( i = 0; i < p->count; ++i )
+			data_res_add( r, ( cpt ) ? (double) ((float *) p->vals)[i] : p->vals[i] );
+
+	r->kept = d->in.count;
+	r->next = r->kept - 1;
+	r->w    = exp( log( data_res_rand( ) ) / (double) r->kept );
+
+	data_res_skip( r );
+
+	return r;
+}
+
+
+// Past the point cap we keep a fixed-size sample, replacing a random
+// one of them now and again, so each point has an even chance of being
+// in it.  Algorithm L works out how far it is to the next one we keep,
+// so most points cost us a kahan sum and a compare.
+static void data_update_sample( DHASH *d, double val, int cpt )
+{
+	DRES *r = d->in.res;
+	int64_t slot;
+	PTLIST *p;
+	float f;
+
+	if( !r )
+		r = d->in.res = data_res_start( d, cpt );
+
+	data_res_add( r, val );
+
+	if( d->in.count++ < r->next )
+		return;
+
+	// replace a random one - they're all the same to us
+	if( ( slot = get_rand( r->kept ) ) >= r->kept )
+		slot = r->kept - 1;
+
+	for( p = d->in.points; p && slot >= p->count; p = p->next )
+		slot -= p->count;
+
+	if( p )
+	{
+		if( cpt )
+		{
+			f = (float) val;
+			((float *) p->vals)[slot] = f;
+			p->rounded |= ( (double) f != val );
+		}
+		else
+			p->vals[slot] = val;
+	}
+
+	data_res_skip( r );
 }
 
 
 __attribute__((hot)) void data_update_stats( DHASH *d, double val, char unused )
 {
+	int cls, cpt;
 	PTLIST *p;
+	float f;
 
 	// lock that path
 	lock_stats( d );
 
+	// sketched paths keep no points
+	if( dhash_do_sketch( d ) )
+	{
+		sketch_add( d->in.sketch, val );
+		++(d->in.count);
+
+		unlock_stats( d );
+
+		data_dirty( d );
+		return;
+	}
+
+	// compact ones hold twice as many
+	cpt = dhash_do_compact( d ) ? 1 : 0;
+
+	// past the cap, we sample
+	if( ctl->stats->max_pts && d->in.count >= ctl->stats->max_pts )
+	{
+		data_update_sample( d, val, cpt );
+
+		unlock_stats( d );
+
+		data_dirty( d );
+		return;
+	}
+
 	// make a new one if need be
-	if( !( p = d->in.points ) || p->count >= PTLIST_SIZE )
+	if( !( p = d->in.points ) || p->count >= ( p->size << cpt ) )
 	{
-		if( !( p = mem_new_points( ) ) )
+		// it's busier than we thought, so go up a class
+		if( !p )
+			cls = PTLIST_CLASS_SML;
+		else if( ( cls = p->cls ) < PTLIST_CLASS_BIG )
+			++cls;
+
+		if( !( p = mem_new_points( cls ) ) )
 		{
 			fatal( "Could not allocate new point struct." );
 			unlock_stats( d );
@@ -114,12 +299,21 @@ __attribute__((hot)) void data_update_stats( DHASH *d, double val, char unused )
 	}
 
 	// keep that data point
-	p->vals[p->count] = val;
+	if( cpt )
+	{
+		f = (float) val;
+		((float *) p->vals)[p->count] = f;
+		p->rounded |= ( (double) f != val );
+	}
+	else
+		p->vals[p->count] = val;
 	++(d->in.count);
 	++(p->count);
 
 	// and unlock
 	unlock_stats( d );
+
+	data_dirty( d );
 }
 
 
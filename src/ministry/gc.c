@@ -25,7 +25,7 @@
 // does not have it's own config - owned by mem.c
 
 
-__attribute__((hot)) int gc_hash_list( DHASH **list, DHASH **flist, PRED **plist, unsigned int idx, int thresh )
+__attribute__((hot)) int gc_hash_list( ST_CFG *c, DHASH **list, DHASH **flist, PRED **plist, unsigned int idx, int thresh )
 {
 	int lock = 0, freed = 0;
 	DHASH *h, *prev, *next;
@@ -37,10 +37,23 @@ __attribute__((hot)) int gc_hash_list( DHASH **list, DHASH **flist, PRED **plist
 
 		if( h->valid == 0 )
 		{
+			// still on a stats thread's dirty list - next time
+			if( __atomic_load_n( &(h->dirty), __ATOMIC_ACQUIRE ) )
+			{
+				prev = h;
+				continue;
+			}
+
 			if( !lock )
 			{
 				lock_table( idx );
 				lock = 1;
+
+				// a create may have pushed onto the head
+				// since we looked, and it must not be lost
+				// from the chain while the index still has it
+				if( !prev && *list != h )
+					for( prev = *list; prev->next != h; prev = prev->next );
 			}
 
 			// remove s
@@ -49,6 +62,9 @@ __attribute__((hot)) int gc_hash_list( DHASH **list, DHASH **flist, PRED **plist
 			else
 				*list = next;
 
+			// and from the lookup index
+			data_index_remove( c->index, h );
+
 			// update the free list
 			h->next = *flist;
 			*flist  = h;
@@ -61,6 +77,12 @@ __attribute__((hot)) int gc_hash_list( DHASH **list, DHASH **flist, PRED **plist
 				pts = h->in.points;
 				h->in.points = NULL;
 
+				if( h->in.res )
+				{
+					free( h->in.res );
+					h->in.res = NULL;
+				}
+
 				unlock_stats( h );
 
 				if( pts )
@@ -113,13 +135,40 @@ __attribute__((hot)) int gc_hash_list( DHASH **list, DHASH **flist, PRED **plist
 }
 
 
+// Each pass does a slice of the table, carrying on from where the last
+// one stopped, so a big table never has gc holding its locks for long.
+// A path is marked on one visit and reaped on the next, so that's a
+// full trip round the table apart.
 void gc_one_set( ST_CFG *c, DHASH **flist, PRED **plist, int thresh )
 {
+	uint64_t i, end;
 	int hits = 0;
-	uint64_t i;
 
-	for( i = 0; i < c->hsize; ++i )
-		hits += gc_hash_list( &(c->data[i]), flist, plist, i, thresh );
+	lock_hash_cfg( c );
+
+	// leave it alone while buckets are moving
+	if( c->hgen & 0x1 )
+	{
+		unlock_hash_cfg( c );
+		return;
+	}
+
+	// tables only grow, so this shouldn't happen
+	if( c->gc_next >= c->hsize )
+		c->gc_next = 0;
+
+	end = c->gc_next + ctl->gc->slice;
+	if( end > c->hsize )
+		end = c->hsize;
+
+	// table locks follow the starting size
+	for( i = c->gc_next; i < end; ++i )
+		hits += gc_hash_list( c, &(c->data[i]), flist, plist, i % c->hbase, thresh );
+
+	// start again next time if we got to the end
+	c->gc_next = ( end < c->hsize ) ? end : 0;
+
+	unlock_hash_cfg( c );
 
 	if( hits > 0 )
 	{
@@ -152,7 +201,7 @@ void gc_pass( int64_t tval, void *arg )
 	gc_one_set( ctl->stats->stats, &flist, &plist, ctl->gc->thresh );
 	gc_one_set( ctl->stats->adder, &flist, &plist, ctl->gc->thresh );
 	gc_one_set( ctl->stats->gauge, &flist, &plist, ctl->gc->gg_thresh );
-	// TODO histo
+	gc_one_set( ctl->stats->histo, &flist, &plist, ctl->gc->thresh );
 
 	if( flist )
 		mem_free_dhash_list( flist );
@@ -183,6 +232,7 @@ GC_CTL *gc_config_defaults( void )
 	g->enabled        = 0;
 	g->thresh         = DEFAULT_GC_THRESH;
 	g->gg_thresh      = DEFAULT_GC_GG_THRESH;
+	g->slice          = DEFAULT_GC_SLICE;
 
 	return g;
 }
@@ -211,6 +261,14 @@ int gc_config_line( AVP *av )
 		debug( "Gauge garbage collection threshold set to %d stats intervals.", t );
 		g->gg_thresh = t;
 	}
+	else if( attIs( "slice" ) || attIs( "bucketsPerPass" ) )
+	{
+		av_int( t );
+		if( t <= 0 )
+			t = DEFAULT_GC_SLICE;
+		debug( "Garbage collection will check %d hash buckets per pass.", t );
+		g->slice = t;
+	}
 	else
 		return -1;
 
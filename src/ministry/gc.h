@@ -24,6 +24,7 @@
 
 #define DEFAULT_GC_THRESH           8640        // 1 day @ 10s
 #define DEFAULT_GC_GG_THRESH        25920       // 3 days @ 10s
+#define DEFAULT_GC_SLICE            32768       // buckets per table per pass
 
 
 struct gc_control
@@ -31,6 +32,7 @@ struct gc_control
 	int64_t					enabled;
 	int64_t					thresh;
 	int64_t					gg_thresh;
+	int64_t					slice;
 };
 
 
@@ -41,16 +41,33 @@ typedef pthread_mutex_t			dhash_lock_t;
 
 #endif
 
-#define lock_adder( d )			lock_dhash( d )
 #define lock_stats( d )			lock_dhash( d )
-#define lock_gauge( d )			lock_dhash( d )
 #define lock_histo( d )			lock_dhash( d )
 
-#define unlock_adder( d )		unlock_dhash( d )
 #define unlock_stats( d )		unlock_dhash( d )
-#define unlock_gauge( d )		unlock_dhash( d )
 #define unlock_histo( d )		unlock_dhash( d )
 
+// with LOCK_DHASH_ATOMIC, adders and gauges never take the
+// dhash lock - their totals and counts are updated with atomic
+// operations instead (see dval_* in data/data.h)
+#ifdef LOCK_DHASH_ATOMIC
+
+#define lock_adder( d )
+#define lock_gauge( d )
+
+#define unlock_adder( d )
+#define unlock_gauge( d )
+
+#else
+
+#define lock_adder( d )			lock_dhash( d )
+#define lock_gauge( d )			lock_dhash( d )
+
+#define unlock_adder( d )		unlock_dhash( d )
+#define unlock_gauge( d )		unlock_dhash( d )
+
+#endif
+
 #define lock_table( idx )		pthread_mutex_lock(   &(ctl->locks->table[idx & HASHT_MUTEX_MASK]) )
 #define unlock_table( idx )		pthread_mutex_unlock( &(ctl->locks->table[idx & HASHT_MUTEX_MASK]) )
 
@@ -66,6 +83,10 @@ typedef pthread_mutex_t			dhash_lock_t;
 #define lock_stat_cfg( _c )		pthread_mutex_lock(   &(_c->statslock ) )
 #define unlock_stat_cfg( _c )	pthread_mutex_unlock( &(_c->statslock ) )
 
+#define lock_hash_cfg( _c )		pthread_mutex_lock(    &(_c->hashlock ) )
+#define trylock_hash_cfg( _c )	pthread_mutex_trylock( &(_c->hashlock ) )
+#define unlock_hash_cfg( _c )	pthread_mutex_unlock(  &(_c->hashlock ) )
+
 
 
 
@@ -104,6 +104,9 @@ void main_create_conf( void )
 	config_register_section( "metrics", &metrics_config_line );
 
 	target_set_type_fn( &targets_set_type );
+
+	// combining tables live on hosts, tcp and udp
+	net_host_callbacks( NULL, &data_combine_free );
 }
 
 
@@ -24,57 +24,105 @@
 
 
 
-void maths_predict_linear( DHASH *d, ST_PRED *sp )
+/*
+ *  Linear regression over a path's history would be a pass over the
+ *  whole ring, for every predicted path, every interval.  Instead we
+ *  keep running sums of t, v, t^2, tv and v^2, taking out the point the
+ *  ring drops and putting in the new one, so each fit is a few sums.
+ *
+ *  The sums are taken from a reference point - the oldest in the ring
+ *  when they were last done in full - because timestamps are large and
+ *  their squares would swamp the spread we care about.  Adding and
+ *  taking away drifts, so once per trip round the ring we do them over.
+ */
+
+static inline void maths_predict_sum( PRED *p, DPT *dp, double sign )
+{
+	double t, v;
+
+	t = dpp_get_t( dp ) - p->t0;
+	v = dpp_get_v( dp ) - p->v0;
+
+	p->st  += sign * t;
+	p->sv  += sign * v;
+	p->stt += sign * t * t;
+	p->stv += sign * t * v;
+	p->svv += sign * v * v;
+}
+
+
+static void maths_predict_sums( PRED *p )
 {
-	double ts, diffx, diffy, meanx, meany, sumy, sumxy, sumxx, sumyy, xxyy, pval;
-	PRED *p = d->predict;
 	HIST *h = p->hist;
 	uint16_t i;
 	DPT *dp;
 
-	// calculate the new value
-	for( sumy = 0.0, i = 0; i < h->size; ++i )
-		sumy += dp_get_v( h->points[i] );
+	dp    = history_get_oldest( h );
+	p->t0 = dpp_get_t( dp );
+	p->v0 = dpp_get_v( dp );
 
-	meany = sumy / (double) h->size;
+	p->st  = p->sv  = 0;
+	p->stt = p->stv = p->svv = 0;
 
-	// average timestamp 
-	dp = history_get_oldest( h );
-	meanx = dpp_get_t( dp );
-	dp = history_get_newest( h );
-	meanx += dpp_get_t( dp );
-	meanx /= 2.0;
+	for( i = 0; i < h->size; ++i )
+		maths_predict_sum( p, h->points + i, 1.0 );
 
-	//debug( "Means: x - %f, y - %f", meanx, meany );
+	p->since  = 0;
+	p->summed = 1;
+}
 
-	sumxx = 0.0, sumyy = 0.0, sumxy = 0.0;
-	for( i = 0; i < h->size; ++i )
-	{
-		dp = h->points + i;
-		diffx = dpp_get_t( dp ) - meanx;
-		diffy = dpp_get_v( dp ) - meany;
 
-		//debug( "Diffs: x - %f, y - %f", diffx, diffy );
+// swap the oldest point for the new one
+void maths_predict_add( PRED *p, int64_t tval, double val )
+{
+	HIST *h = p->hist;
+
+	if( p->summed )
+		maths_predict_sum( p, history_get_oldest( h ), -1.0 );
+
+	history_add_point( h, tval, val );
 
-		sumxy += diffx * diffy;
-		sumxx += diffx * diffx;
-		sumyy += diffy * diffy;
+	if( p->summed )
+	{
+		maths_predict_sum( p, history_get_newest( h ), 1.0 );
+		++(p->since);
 	}
+}
+
+
+void maths_predict_linear( DHASH *d, ST_PRED *sp )
+{
+	double ts, n, meanx, meany, sumxx, sumxy, sumyy, xxyy, pval;
+	PRED *p = d->predict;
+	HIST *h = p->hist;
+
+	// the first time, and once round the ring, do them properly
+	if( !p->summed || p->since >= h->size )
+		maths_predict_sums( p );
 
-	//debug( "Sums: xx - %f, xy - %f, yy - %f", sumxx, sumxy, sumyy );
+	n     = (double) h->size;
+	meanx = p->st / n;
+	meany = p->sv / n;
 
-	// coefficients
-	p->b = sumxy / sumxx;
-	p->a = meany - ( p->b * meanx );
+	sumxx = p->stt - ( p->st * meanx );
+	sumxy = p->stv - ( p->st * meany );
+	sumyy = p->svv - ( p->sv * meany );
+
+	// coefficients - back from our reference point
+	p->b = ( sumxx > 0 ) ? sumxy / sumxx : 0.0;
+	p->a = ( p->v0 + meany ) - ( p->b * ( p->t0 + meanx ) );
 
-	//debug( "Coefs: a - %f, b - %f", p->a, p->b );
 	xxyy = sumyy * sumxx;
 
-	if( xxyy != 0.0 )
+	if( xxyy > 0 )
 		p->fit = ( sumxy * sumxy ) / xxyy;
 	else
 		p->fit = 0.0;
 
+	// rounding can just tip it over
+	if( p->fit > 1.0 )
+		p->fit = 1.0;
+
 	// now we are in business
 	ts = dp_get_t( p->prediction );
 	pval = p->a + ( p->b * ts );
@@ -83,29 +131,71 @@ void maths_predict_linear( DHASH *d, ST_PRED *sp )
 
 
 
-// an implementation of Kaham Summation
-// https://en.wikipedia.org/wiki/Kahan_summation_algorithm
-// useful to avoid floating point errors
-static inline void maths_kahan_sum( double val, double *sum, double *low )
+// do we use the vector kernels?
+static int maths_simd = 0;
+
+int maths_simd_init( int enable )
 {
-	double y, t;
+#ifdef MATHS_SIMD_AVX2
+	__builtin_cpu_init( );
 
-	y = val - *low;     // low starts off small
-	t = *sum + y;       // sum is big, y small, lo-order y is lost
+	if( enable && __builtin_cpu_supports( "avx2" ) )
+		maths_simd = 1;
+#endif
 
-	*low = ( t - *sum ) - y;// (t-sum) is hi-order y, -y recovers lo-order
-	*sum = t;           // low is algebraically always 0
+	return maths_simd;
 }
 
+
+
 void maths_kahan_summation( double *list, int len, double *sum )
 {
 	double low = 0;
 	int i;
 
+#ifdef MATHS_SIMD_AVX2
+	if( maths_simd && len >= MATHS_SIMD_MIN )
+	{
+		maths_simd_kahan( list, len, sum, NULL, NULL );
+		return;
+	}
+#endif
+
+	for( *sum = 0, i = 0; i < len; ++i )
+		maths_kahan_sum( list[i], sum, &low );
+
+	*sum -= low;
+}
+
+// and find the ends while we're there
+void maths_kahan_summation_range( double *list, int len, double *sum, double *min, double *max )
+{
+	double low = 0, mn, mx;
+	int i;
+
+#ifdef MATHS_SIMD_AVX2
+	if( maths_simd && len >= MATHS_SIMD_MIN )
+	{
+		maths_simd_kahan( list, len, sum, min, max );
+		return;
+	}
+#endif
+
+	mn = mx = list[0];
+
 	for( *sum = 0, i = 0; i < len; ++i )
+	{
 		maths_kahan_sum( list[i], sum, &low );
 
-	*sum += low;
+		if( list[i] < mn )
+			mn = list[i];
+		else if( list[i] > mx )
+			mx = list[i];
+	}
+
+	*sum -= low;
+	*min  = mn;
+	*max  = mx;
 }
 
 // https://en.wikipedia.org/wiki/Standard_deviation#Estimation
@@ -134,29 +224,36 @@ void maths_moments( MOMS *m )
 		m->mean /= ct;
 	}
 
-	for( i = 0; i < m->count; ++i )
+#ifdef MATHS_SIMD_AVX2
+	if( maths_simd && m->count >= MATHS_SIMD_MIN )
+		maths_simd_moments( m->input, m->count, m->mean, &sdev, &skew, &kurt );
+	else
+#endif
 	{
-		// diff from mean
-		diff = m->input[i] - m->mean;
-		prod = diff * diff;
-
-		// stddev needs sum of squares of diffs
-		maths_kahan_sum( prod, &sdev, &dtmp );
-
-		// skewness needs third moment
-		prod *= diff;
-		maths_kahan_sum( prod, &skew, &stmp );
-
-		// kurtosis needs fourth moment
-		prod *= diff;
-		maths_kahan_sum( prod, &kurt, &ktmp );
+		for( i = 0; i < m->count; ++i )
+		{
+			// diff from mean
+			diff = m->input[i] - m->mean;
+			prod = diff * diff;
+
+			// stddev needs sum of squares of diffs
+			maths_kahan_sum( prod, &sdev, &dtmp );
+
+			// skewness needs third moment
+			prod *= diff;
+			maths_kahan_sum( prod, &skew, &stmp );
+
+			// kurtosis needs fourth moment
+			prod *= diff;
+			maths_kahan_sum( prod, &kurt, &ktmp );
+		}
+
+		// complete the kahan sum
+		sdev -= dtmp;
+		skew -= stmp;
+		kurt -= ktmp;
 	}
 
-	// complete the kahan sum
-	sdev += dtmp;
-	skew += stmp;
-	kurt += ktmp;
-
 	// we don't need corrected - we have the whole population
 	sdev /= ct;
 	kurt /= ct;
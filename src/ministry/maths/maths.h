@@ -33,6 +33,22 @@
 
 #define F8_SORT_HIST_SIZE					2048		// 11 bits
 
+#define SKETCH_MIN_BINS						64
+
+#define PSORT_BUCKETS						64			// power of two
+#define PSORT_OVERSAMPLE					16			// samples per bucket
+#define PSORT_WAIT_NSEC						200000000	// helper idle check
+#define DEFAULT_PSORT_HELPERS				2
+#define DEFAULT_PSORT_THRESHOLD				1000000
+#define MIN_PSORT_THRESHOLD					65536
+
+#define MATHS_SIMD_MIN						64			// below this, stay scalar
+
+// x86-64 gcc can build the AVX2 kernels, whatever the target
+#if defined( __x86_64__ ) && !defined( NO_SIMD )
+#define MATHS_SIMD_AVX2
+#endif
+
 
 
 
@@ -73,10 +89,22 @@ struct maths_prediction
 //	double				c;
 //	double				d;
 	double				fit;	// quality coefficient
+
+	// running sums over the history, from a reference point
+	double				t0;
+	double				v0;
+	double				st;
+	double				sv;
+	double				stt;
+	double				stv;
+	double				svv;
+
 	uint16_t			vcount;
 	uint16_t			pcount;
+	uint16_t			since;	// adds since the sums were redone
 	uint8_t				valid;
 	uint8_t				pflag;
+	uint8_t				summed;
 };
 
 
@@ -94,19 +122,117 @@ struct maths_moments
 };
 
 
+// one side of a sketch - counts by log-bucket key
+struct maths_sketch_store
+{
+	int64_t			*	counts;
+	int64_t				n;
+	int32_t				off;	// key of counts[0]
+	int32_t				sz;
+	int32_t				lo;		// keys in use
+	int32_t				hi;
+};
+
+
+// quantile sketch with bounded relative error,
+// hung off a DHASH instead of its points list
+struct maths_sketch
+{
+	ST_SKCH			*	conf;
+	SKSTORE				pos;
+	SKSTORE				neg;	// keyed on -val
+	int64_t				zero;
+	int64_t				count;
+	double				sum;
+	double				min;
+	double				max;
+};
+
+
+// pool of helpers for sorting very large sets
+struct maths_psort
+{
+	pthread_mutex_t		lock;		// one sort at a time
+	pthread_mutex_t		wlock;		// for the helpers
+	pthread_cond_t		go;
+	pthread_cond_t		done;
+
+	double			*	src;
+	double			*	dst;
+	int64_t			*	counts;		// per chunk, per bucket
+	int64_t			*	boff;		// bucket starts in dst
+	double				split[PSORT_BUCKETS - 1];
+
+	int64_t				ct;
+	int64_t				chunk;
+	int32_t				nchunk;
+	int32_t				ntask;
+	int32_t				next;
+	int32_t				working;
+	int32_t				helpers;
+	int32_t				phase;
+	uint32_t			gen;
+	uint32_t			sgen;		// gen when the helpers were thrown
+
+	LLCT				uses;
+	LLCT				usec;
+	LLCT				busy;		// fell back to sorting alone
+};
+
+
+// an implementation of Kahan Summation
+// https://en.wikipedia.org/wiki/Kahan_summation_algorithm
+// useful to avoid floating point errors
+// low is what sum is over by - take it off at the end
+static inline void maths_kahan_sum( double val, double *sum, double *low )
+{
+	double y, t;
+
+	y = val - *low;     // low starts off small
+	t = *sum + y;       // sum is big, y small, lo-order y is lost
+
+	*low = ( t - *sum ) - y;// (t-sum) is hi-order y, -y recovers lo-order
+	*sum = t;           // low is algebraically always 0
+}
+
+
 // I'll do more at some point
 void maths_predict_linear( DHASH *d, ST_PRED *sp );
+void maths_predict_add( PRED *p, int64_t tval, double val );
+
+// vector kernels, if we have them
+int maths_simd_init( int enable );
+#ifdef MATHS_SIMD_AVX2
+void maths_simd_kahan( double *list, int64_t len, double *sum, double *min, double *max );
+void maths_simd_moments( double *list, int64_t len, double mean, double *m2, double *m3, double *m4 );
+#endif
 
 // see https://en.wikipedia.org/wiki/Kahan_summation_algorithm
 void maths_kahan_summation( double *list, int len, double *sum );
+void maths_kahan_summation_range( double *list, int len, double *sum, double *min, double *max );
 void maths_moments( MOMS *m );
 
 // sorting functions
 void sort_qsort_glibc( ST_THR *t, int32_t ct );		// legacy
 void sort_qsort_dbl( ST_THR *t, int32_t ct );		// faster below 10k
 void sort_radix11( ST_THR *t, int32_t ct );			// faster above 10k
+float *sort_radix11_flt( ST_THR *t, float *arr, float *tmp, int32_t ct );	// compact points
 
 void sort_qsort_dbl_arr( double *arr, int32_t ct );	// fn exposed for histogram bounds
+void sort_select_dbl( double *arr, int32_t ct, int32_t *ranks, int nr );	// just the ranks we want
+
+// parallel sorting
+int psort_dbl( PSORT *p, double *src, double *dst, int32_t ct );
+PSORT *psort_create( int helpers );
+void psort_start( PSORT *p, int helpers );
+throw_fn psort_helper;
+
+// quantile sketches
+SKETCH *sketch_create( ST_SKCH *c );
+void sketch_free( SKETCH *s );
+void sketch_add( SKETCH *s, double v );
+double sketch_value( SKETCH *s, int64_t rank );
+void sketch_reset( SKETCH *s );
 
 // history functions
 #define history_get_newest( _h )	( _h->points + _h->curr )
@@ -0,0 +1,294 @@
+/**************************************************************************
+* Copyright 2015 John Denholm                                             *
+*                                                                         *
+* Licensed under the Apache License, Version 2.0 (the "License");         *
+* you may not use this file except in compliance with the License.        *
+* You may obtain a copy of the License at                                 *
+*                                                                         *
+*     http://www.apache.org/licenses/LICENSE-2.0                          *
+*                                                                         *
+* Unless required by applicable law or agreed to in writing, software     *
+* distributed under the License is distributed on an "AS IS" BASIS,       *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.*
+* See the License for the specific language governing permissions and     *
+* limitations under the License.                                          *
+*                                                                         *
+*                                                                         *
+* maths/psort.c - parallel sample sort for very large point sets          *
+*                                                                         *
+* Updates:                                                                *
+**************************************************************************/
+
+#include "ministry.h"
+
+
+/*
+ *  One path with millions of points an interval holds up the whole of
+ *  its stats thread while it sorts, and the other threads may well be
+ *  idle by then.  So past a threshold we hand the sort to a small pool
+ *  of helper threads, and the stats thread joins in.
+ *
+ *  It's a sample sort:  we pick splitters from a sorted sample, count
+ *  each chunk of the input into buckets between them, scatter the
+ *  chunks into the second buffer at offsets worked out from the counts,
+ *  and then sort each bucket on its own.  Every phase is a list of
+ *  tasks handed out with an atomic counter, so nobody waits on a slow
+ *  thread until the end of the phase.
+ *
+ *  There is one pool, so one parallel sort at a time.  Anyone who
+ *  finds it busy just sorts on their own, as before.
+ */
+
+
+enum psort_phases
+{
+	PSORT_PHASE_COUNT = 0,
+	PSORT_PHASE_SCATTER,
+	PSORT_PHASE_SORT
+};
+
+
+
+// which bucket does v fall in - splitters are sorted
+__attribute__((hot)) static inline int psort_bucket( PSORT *p, double v )
+{
+	int b = 0, s;
+
+	for( s = PSORT_BUCKETS >> 1; s; s >>= 1 )
+		if( v > p->split[b + s - 1] )
+			b += s;
+
+	return b;
+}
+
+
+__attribute__((hot)) static void psort_task( PSORT *p, int phase, int32_t i )
+{
+	int64_t *c, from, to, j;
+	double *arr;
+
+	switch( phase )
+	{
+		case PSORT_PHASE_COUNT:
+			c    = p->counts + ( i * PSORT_BUCKETS );
+			from = (int64_t) i * p->chunk;
+			to   = from + p->chunk;
+			if( to > p->ct )
+				to = p->ct;
+
+			memset( c, 0, PSORT_BUCKETS * sizeof( int64_t ) );
+			for( j = from; j < to; ++j )
+				++(c[psort_bucket( p, p->src[j] )]);
+			break;
+
+		case PSORT_PHASE_SCATTER:
+			// counts are now write offsets
+			c    = p->counts + ( i * PSORT_BUCKETS );
+			from = (int64_t) i * p->chunk;
+			to   = from + p->chunk;
+			if( to > p->ct )
+				to = p->ct;
+
+			for( j = from; j < to; ++j )
+				p->dst[c[psort_bucket( p, p->src[j] )]++] = p->src[j];
+			break;
+
+		case PSORT_PHASE_SORT:
+			arr = p->dst + p->boff[i];
+			sort_qsort_dbl_arr( arr, (int32_t) ( p->boff[i+1] - p->boff[i] ) );
+			break;
+	}
+}
+
+
+static void psort_take_tasks( PSORT *p, int phase )
+{
+	int32_t i;
+
+	while( ( i = __atomic_fetch_add( &(p->next), 1, __ATOMIC_ACQ_REL ) ) < p->ntask )
+		psort_task( p, phase, i );
+}
+
+
+// hand a phase out and do our share of it
+static void psort_run_phase( PSORT *p, int phase, int32_t ntask )
+{
+	pthread_mutex_lock( &(p->wlock) );
+
+	p->phase   = phase;
+	p->ntask   = ntask;
+	p->next    = 0;
+	p->working = p->helpers;
+	++(p->gen);
+
+	pthread_cond_broadcast( &(p->go) );
+	pthread_mutex_unlock( &(p->wlock) );
+
+	psort_take_tasks( p, phase );
+
+	pthread_mutex_lock( &(p->wlock) );
+
+	while( p->working > 0 )
+		pthread_cond_wait( &(p->done), &(p->wlock) );
+
+	pthread_mutex_unlock( &(p->wlock) );
+}
+
+
+
+// sorts src into dst - returns nonzero if the caller should sort it
+int psort_dbl( PSORT *p, double *src, double *dst, int32_t ct )
+{
+	double samp[PSORT_BUCKETS * PSORT_OVERSAMPLE];
+	int64_t sum, start, *c;
+	int32_t i, j, ns, stride;
+	int64_t t;
+
+	if( !p || !p->helpers )
+		return -1;
+
+	if( pthread_mutex_trylock( &(p->lock) ) )
+	{
+		__atomic_add_fetch( &(p->busy.count), 1, __ATOMIC_RELAXED );
+		return -1;
+	}
+
+	t = get_time64( );
+
+	// take an even spread for the splitters
+	ns     = PSORT_BUCKETS * PSORT_OVERSAMPLE;
+	stride = ct / ns;
+
+	for( i = 0; i < ns; ++i )
+		samp[i] = src[(int64_t) i * stride];
+
+	sort_qsort_dbl_arr( samp, ns );
+
+	// nan's don't order, so we can't bucket on them
+	if( isnan( samp[0] ) || isnan( samp[ns - 1] ) )
+	{
+		pthread_mutex_unlock( &(p->lock) );
+		return -1;
+	}
+
+	for( i = 1; i < PSORT_BUCKETS; ++i )
+		p->split[i - 1] = samp[i * PSORT_OVERSAMPLE];
+
+	p->src    = src;
+	p->dst    = dst;
+	p->ct     = ct;
+	p->chunk  = ( ct + p->nchunk - 1 ) / p->nchunk;
+
+	psort_run_phase( p, PSORT_PHASE_COUNT, p->nchunk );
+
+	// turn the counts into write offsets, bucket-major
+	for( sum = 0, j = 0; j < PSORT_BUCKETS; ++j )
+	{
+		p->boff[j] = sum;
+
+		for( i = 0; i < p->nchunk; ++i )
+		{
+			c     = p->counts + ( i * PSORT_BUCKETS ) + j;
+			start = sum;
+			sum  += *c;
+			*c    = start;
+		}
+	}
+	p->boff[PSORT_BUCKETS] = sum;
+
+	psort_run_phase( p, PSORT_PHASE_SCATTER, p->nchunk );
+	psort_run_phase( p, PSORT_PHASE_SORT, PSORT_BUCKETS );
+
+	p->uses.count += 1;
+	p->usec.count += ( get_time64( ) - t ) / 1000;
+
+	pthread_mutex_unlock( &(p->lock) );
+
+	return 0;
+}
+
+
+
+void psort_helper( THRD *t )
+{
+	struct timespec ts;
+	PSORT *p = (PSORT *) t->arg;
+	uint32_t gen;
+	int64_t tv;
+
+	loop_mark_start( "psort" );
+
+	pthread_mutex_lock( &(p->wlock) );
+
+	// a phase may have been posted before we got here,
+	// counting us in, so start from when we were thrown
+	gen = p->sgen;
+
+	while( 1 )
+	{
+		// anything new gets done, even when stopping
+		if( p->gen == gen )
+		{
+			if( !RUNNING( ) )
+				break;
+
+			tv = get_time64( ) + PSORT_WAIT_NSEC;
+			llts( tv, ts );
+			pthread_cond_timedwait( &(p->go), &(p->wlock), &ts );
+			continue;
+		}
+
+		gen = p->gen;
+		pthread_mutex_unlock( &(p->wlock) );
+
+		psort_take_tasks( p, p->phase );
+
+		pthread_mutex_lock( &(p->wlock) );
+
+		if( --(p->working) == 0 )
+			pthread_cond_signal( &(p->done) );
+	}
+
+	// don't count us in any more
+	--(p->helpers);
+	pthread_mutex_unlock( &(p->wlock) );
+
+	loop_mark_done( "psort", 0, 0 );
+}
+
+
+
+PSORT *psort_create( int helpers )
+{
+	PSORT *p = (PSORT *) mem_perm( sizeof( PSORT ) );
+
+	pthread_mutex_init( &(p->lock),  NULL );
+	pthread_mutex_init( &(p->wlock), NULL );
+	pthread_cond_init( &(p->go),   NULL );
+	pthread_cond_init( &(p->done), NULL );
+
+	// a few chunks each evens out the phases
+	p->nchunk = 4 * ( helpers + 1 );
+	p->counts = (int64_t *) mem_perm( p->nchunk * PSORT_BUCKETS * sizeof( int64_t ) );
+	p->boff   = (int64_t *) mem_perm( ( PSORT_BUCKETS + 1 ) * sizeof( int64_t ) );
+
+	return p;
+}
+
+
+void psort_start( PSORT *p, int helpers )
+{
+	int i;
+
+	// they count themselves out as they stop
+	pthread_mutex_lock( &(p->wlock) );
+	p->helpers = helpers;
+	p->sgen    = p->gen;
+	pthread_mutex_unlock( &(p->wlock) );
+
+	for( i = 0; i < helpers; ++i )
+		thread_throw_named_f( &psort_helper, p, i, "psort_%d", i );
+
+	info( "Started %d parallel sort helpers.", helpers );
+}
+
@@ -0,0 +1,224 @@
+/**************************************************************************
+* Copyright 2015 John Denholm                                             *
+*                                                                         *
+* Licensed under the Apache License, Version 2.0 (the "License");         *
+* you may not use this file except in compliance with the License.        *
+* You may obtain a copy of the License at                                 *
+*                                                                         *
+*     http://www.apache.org/licenses/LICENSE-2.0                          *
+*                                                                         *
+* Unless required by applicable law or agreed to in writing, software     *
+* distributed under the License is distributed on an "AS IS" BASIS,       *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.*
+* See the License for the specific language governing permissions and     *
+* limitations under the License.                                          *
+*                                                                         *
+*                                                                         *
+* maths/simd.c - vector versions of the summing loops                     *
+*                                                                         *
+* Updates:                                                                *
+**************************************************************************/
+
+#include "ministry.h"
+
+
+/*
+ *  Every big stats path is summed each interval, and those with moments
+ *  are walked again for them.  The scalar kahan loops are bound by the
+ *  chain through the running sum and its compensation, not by memory,
+ *  so we run sixteen of them side by side in AVX2 registers and fold
+ *  them together at the end.
+ *
+ *  These are built for AVX2 whatever the compiler defaults to, and only
+ *  called if the cpu says it has it.  They don't use FMA - fusing the
+ *  multiply and subtract would change what the compensation catches.
+ *
+ *  The order of addition differs from the scalar loops, so the results
+ *  can differ too, but both are compensated sums, each within 2 * eps
+ *  of the sum of the magnitudes.  So they agree to within 4 * eps of
+ *  it, far below the precision we write values out at.  Min and max are
+ *  exact, and the same.  scripts/simdcheck.c checks all of that.
+ */
+
+
+#ifdef MATHS_SIMD_AVX2
+
+#include <immintrin.h>
+
+#define SIMD_TGT		__attribute__((target("avx2")))
+#define SIMD_INL		__attribute__((target("avx2"), always_inline))
+
+
+static inline SIMD_INL void simd_kahan( __m256d x, __m256d *s, __m256d *c )
+{
+	__m256d y, t;
+
+	y  = _mm256_sub_pd( x, *c );
+	t  = _mm256_add_pd( *s, y );
+	*c = _mm256_sub_pd( _mm256_sub_pd( t, *s ), y );
+	*s = t;
+}
+
+
+// fold the lanes together, sums and compensations both
+static inline SIMD_INL void simd_fold( __m256d *s, __m256d *c, int n, double *sum, double *low )
+{
+	double vs[4], vc[4];
+	int i, j;
+
+	for( i = 0; i < n; ++i )
+	{
+		_mm256_storeu_pd( vs, s[i] );
+		_mm256_storeu_pd( vc, c[i] );
+
+		for( j = 0; j < 4; ++j )
+		{
+			maths_kahan_sum( vs[j], sum, low );
+			maths_kahan_sum( -vc[j], sum, low );
+		}
+	}
+}
+
+
+static inline SIMD_INL double simd_hmin( __m256d v )
+{
+	double d[4];
+
+	_mm256_storeu_pd( d, v );
+
+	d[0] = ( d[1] < d[0] ) ? d[1] : d[0];
+	d[2] = ( d[3] < d[2] ) ? d[3] : d[2];
+
+	return ( d[2] < d[0] ) ? d[2] : d[0];
+}
+
+static inline SIMD_INL double simd_hmax( __m256d v )
+{
+	double d[4];
+
+	_mm256_storeu_pd( d, v );
+
+	d[0] = ( d[1] > d[0] ) ? d[1] : d[0];
+	d[2] = ( d[3] > d[2] ) ? d[3] : d[2];
+
+	return ( d[2] > d[0] ) ? d[2] : d[0];
+}
+
+
+
+__attribute__((hot)) SIMD_TGT void maths_simd_kahan( double *list, int64_t len, double *sum, double *min, double *max )
+{
+	__m256d s[4], c[4], x[4], mn, mx;
+	double sm = 0, low = 0;
+	int64_t i;
+	int j;
+
+	for( j = 0; j < 4; ++j )
+	{
+		s[j] = _mm256_setzero_pd( );
+		c[j] = _mm256_setzero_pd( );
+	}
+
+	// putting the new value first means a nan never wins
+	mn = _mm256_set1_pd( list[0] );
+	mx = mn;
+
+	for( i = 0; ( i + 16 ) <= len; i += 16 )
+	{
+		for( j = 0; j < 4; ++j )
+		{
+			x[j] = _mm256_loadu_pd( list + i + ( j << 2 ) );
+			simd_kahan( x[j], s + j, c + j );
+		}
+
+		if( min )
+			for( j = 0; j < 4; ++j )
+			{
+				mn = _mm256_min_pd( x[j], mn );
+				mx = _mm256_max_pd( x[j], mx );
+			}
+	}
+
+	simd_fold( s, c, 4, &sm, &low );
+
+	if( min )
+	{
+		*min = simd_hmin( mn );
+		*max = simd_hmax( mx );
+	}
+
+	// and the stragglers
+	for( ; i < len; ++i )
+	{
+		maths_kahan_sum( list[i], &sm, &low );
+
+		if( min )
+		{
+			if( list[i] < *min )
+				*min = list[i];
+			if( list[i] > *max )
+				*max = list[i];
+		}
+	}
+
+	*sum = sm - low;
+}
+
+
+
+// the second, third and fourth central moments, in one pass
+__attribute__((hot)) SIMD_TGT void maths_simd_moments( double *list, int64_t len, double mean, double *m2, double *m3, double *m4 )
+{
+	__m256d s2[2], c2[2], s3[2], c3[2], s4[2], c4[2], mv, d, p;
+	double l2 = 0, l3 = 0, l4 = 0, df, pr;
+	int64_t i;
+	int j;
+
+	for( j = 0; j < 2; ++j )
+	{
+		s2[j] = c2[j] = _mm256_setzero_pd( );
+		s3[j] = c3[j] = _mm256_setzero_pd( );
+		s4[j] = c4[j] = _mm256_setzero_pd( );
+	}
+
+	mv = _mm256_set1_pd( mean );
+
+	for( i = 0; ( i + 8 ) <= len; i += 8 )
+		for( j = 0; j < 2; ++j )
+		{
+			d = _mm256_sub_pd( _mm256_loadu_pd( list + i + ( j << 2 ) ), mv );
+			p = _mm256_mul_pd( d, d );
+			simd_kahan( p, s2 + j, c2 + j );
+
+			p = _mm256_mul_pd( p, d );
+			simd_kahan( p, s3 + j, c3 + j );
+
+			p = _mm256_mul_pd( p, d );
+			simd_kahan( p, s4 + j, c4 + j );
+		}
+
+	*m2 = *m3 = *m4 = 0;
+
+	simd_fold( s2, c2, 2, m2, &l2 );
+	simd_fold( s3, c3, 2, m3, &l3 );
+	simd_fold( s4, c4, 2, m4, &l4 );
+
+	for( ; i < len; ++i )
+	{
+		df = list[i] - mean;
+		pr = df * df;
+		maths_kahan_sum( pr, m2, &l2 );
+		pr *= df;
+		maths_kahan_sum( pr, m3, &l3 );
+		pr *= df;
+		maths_kahan_sum( pr, m4, &l4 );
+	}
+
+	*m2 -= l2;
+	*m3 -= l3;
+	*m4 -= l4;
+}
+
+
+#endif
+
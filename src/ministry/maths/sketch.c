@@ -0,0 +1,242 @@
+/**************************************************************************
+* Copyright 2015 John Denholm                                             *
+*                                                                         *
+* Licensed under the Apache License, Version 2.0 (the "License");         *
+* you may not use this file except in compliance with the License.        *
+* You may obtain a copy of the License at                                 *
+*                                                                         *
+*     http://www.apache.org/licenses/LICENSE-2.0                          *
+*                                                                         *
+* Unless required by applicable law or agreed to in writing, software     *
+* distributed under the License is distributed on an "AS IS" BASIS,       *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.*
+* See the License for the specific language governing permissions and     *
+* limitations under the License.                                          *
+*                                                                         *
+*                                                                         *
+* maths/sketch.c - streaming quantile sketches                            *
+*                                                                         *
+* Updates:                                                                *
+**************************************************************************/
+
+#include "ministry.h"
+
+
+/*
+ *  Sorting every point to read off a handful of thresholds is the most
+ *  expensive thing we do, in memory and cpu, on paths that get millions
+ *  of points an interval.  For those we can keep a sketch instead.
+ *
+ *  This follows DDSketch:  a value v goes in bucket ceil( log_g( v ) ),
+ *  where g = ( 1 + a ) / ( 1 - a ) for relative accuracy a.  Reading a
+ *  bucket back as 2g^k / ( g + 1 ) is then within a of every value in
+ *  it.  Negative values have their own buckets, keyed on -v, and zero
+ *  is just counted.
+ *
+ *  Each side is a dense array of counts over the keys in use, grown as
+ *  the range widens.  It is capped at the configured bin count - past
+ *  that the smallest magnitudes are folded together, so the accuracy
+ *  guarantee goes first for the values nearest zero.  Count, sum, min
+ *  and max are exact.
+ */
+
+
+
+static int32_t sketch_store_grow( SKSTORE *st, int32_t k, int32_t maxb )
+{
+	int32_t lo, hi, sz, off, i, j;
+	int64_t *c;
+
+	lo = ( st->n && st->lo < k ) ? st->lo : k;
+	hi = ( st->n && st->hi > k ) ? st->hi : k;
+
+	// fold the smallest together if it's too wide
+	if( ( hi - lo ) >= maxb )
+		lo = hi - maxb + 1;
+
+	for( sz = SKETCH_MIN_BINS; sz < ( hi - lo + 1 ); sz <<= 1 );
+
+	// leave room either side
+	off = lo - ( ( sz - ( hi - lo + 1 ) ) / 2 );
+	c   = (int64_t *) allocz( sz * sizeof( int64_t ) );
+
+	if( st->n )
+	{
+		for( i = st->lo; i <= st->hi; ++i )
+		{
+			j = ( i < lo ) ? lo : i;
+			c[j - off] += st->counts[i - st->off];
+		}
+
+		if( st->lo < lo )
+			st->lo = lo;
+	}
+
+	if( st->counts )
+		free( st->counts );
+
+	st->counts = c;
+	st->off    = off;
+	st->sz     = sz;
+
+	return ( k < lo ) ? lo : k;
+}
+
+
+__attribute__((hot)) static inline void sketch_store_add( SKSTORE *st, int32_t k, int32_t maxb )
+{
+	if( !st->counts || k < st->off || k >= ( st->off + st->sz ) )
+		k = sketch_store_grow( st, k, maxb );
+
+	++(st->counts[k - st->off]);
+
+	if( !st->n )
+	{
+		st->lo = k;
+		st->hi = k;
+	}
+	else if( k < st->lo )
+		st->lo = k;
+	else if( k > st->hi )
+		st->hi = k;
+
+	++(st->n);
+}
+
+
+static inline double sketch_key_value( ST_SKCH *c, int32_t k )
+{
+	return exp( c->lngamma * (double) k ) * c->vmul;
+}
+
+
+__attribute__((hot)) void sketch_add( SKETCH *s, double v )
+{
+	ST_SKCH *c = s->conf;
+
+	// there's no bucket for these
+	if( !isfinite( v ) )
+		return;
+
+	if( v > 0 )
+		sketch_store_add( &(s->pos), (int32_t) ceil( log( v ) * c->lgmul ), c->bins );
+	else if( v < 0 )
+		sketch_store_add( &(s->neg), (int32_t) ceil( log( -v ) * c->lgmul ), c->bins );
+	else
+		++(s->zero);
+
+	if( !s->count )
+	{
+		s->min = v;
+		s->max = v;
+	}
+	else if( v < s->min )
+		s->min = v;
+	else if( v > s->max )
+		s->max = v;
+
+	s->sum += v;
+	++(s->count);
+}
+
+
+// the value at this rank, counting from 0, as if we had sorted them
+double sketch_value( SKETCH *s, int64_t rank )
+{
+	ST_SKCH *c = s->conf;
+	SKSTORE *st;
+	int64_t n;
+	int32_t k;
+	double v;
+
+	if( !s->count )
+		return 0;
+
+	if( rank >= s->count )
+		rank = s->count - 1;
+
+	// the ends we know exactly
+	if( rank == 0 )
+		return s->min;
+	if( rank == s->count - 1 )
+		return s->max;
+
+	// negatives come first, largest magnitude down
+	if( rank < s->neg.n )
+	{
+		st = &(s->neg);
+
+		for( n = 0, k = st->hi; k > st->lo; --k )
+			if( ( n += st->counts[k - st->off] ) > rank )
+				break;
+
+		v = -sketch_key_value( c, k );
+	}
+	else if( ( rank -= s->neg.n ) < s->zero )
+		return 0;
+	else
+	{
+		rank -= s->zero;
+		st = &(s->pos);
+
+		for( n = 0, k = st->lo; k < st->hi; ++k )
+			if( ( n += st->counts[k - st->off] ) > rank )
+				break;
+
+		v = sketch_key_value( c, k );
+	}
+
+	// never report outside what we saw
+	if( v < s->min )
+		return s->min;
+	if( v > s->max )
+		return s->max;
+
+	return v;
+}
+
+
+static inline void sketch_store_reset( SKSTORE *st )
+{
+	if( st->n )
+	{
+		memset( st->counts + ( st->lo - st->off ), 0, ( st->hi - st->lo + 1 ) * sizeof( int64_t ) );
+		st->n = 0;
+	}
+}
+
+
+// keeps the bins, as the next interval probably wants the same range
+void sketch_reset( SKETCH *s )
+{
+	sketch_store_reset( &(s->pos) );
+	sketch_store_reset( &(s->neg) );
+
+	s->zero  = 0;
+	s->count = 0;
+	s->sum   = 0;
+	s->min   = 0;
+	s->max   = 0;
+}
+
+
+SKETCH *sketch_create( ST_SKCH *c )
+{
+	SKETCH *s = (SKETCH *) allocz( sizeof( SKETCH ) );
+
+	s->conf = c;
+
+	return s;
+}
+
+
+void sketch_free( SKETCH *s )
+{
+	if( s->pos.counts )
+		free( s->pos.counts );
+	if( s->neg.counts )
+		free( s->neg.counts );
+
+	free( s );
+}
+
@@ -193,6 +193,73 @@ void sort_radix11( ST_THR *t, int32_t ct )
 
 
 
+/*
+ *  The same for floats, from compact stats paths.  Half the width means
+ *  three passes (11, 11 and 10 bits) over half the memory.  Three is odd,
+ *  so the result ends up in tmp, which we return.
+ */
+
+static inline uint32_t f4_sort_FloatFlip( uint32_t u )
+{
+	uint32_t mask       =  -(u >> 31) | 0x80000000u;
+	return                  (u ^ mask);
+}
+
+static inline uint32_t f4_sort_IFloatFlip( uint32_t u )
+{
+	uint32_t mask       =  ((u >> 31) - 1) | 0x80000000u;
+	return                  (u ^ mask);
+}
+
+float *sort_radix11_flt( ST_THR *t, float *arr, float *tmp, int32_t ct )
+{
+	uint32_t sum0, sum1, sum2, tsum, u;
+	uint32_t *b0, *b1, *b2, *buf1, *buf2;
+	register int32_t n;
+	int32_t j;
+
+	sum0 = sum1 = sum2 = 0;
+
+	buf1 = (uint32_t *) arr;
+	buf2 = (uint32_t *) tmp;
+
+	memset( t->counters, 0, 3 * F8_SORT_HIST_SIZE * sizeof( uint32_t ) );
+
+	b0 = t->counters;
+	b1 = b0 + F8_SORT_HIST_SIZE;
+	b2 = b1 + F8_SORT_HIST_SIZE;
+
+	for( n = 0; n < ct; ++n )
+	{
+		u = f4_sort_FloatFlip( buf1[n] );
+		buf1[n] = u;
+
+		b0[u & 0x7FF]++;
+		b1[(u >> 11) & 0x7FF]++;
+		b2[u >> 22]++;
+	}
+
+	for( j = 0; j < F8_SORT_HIST_SIZE; ++j )
+	{
+		tsum = b0[j] + sum0; b0[j] = sum0 - 1; sum0 = tsum;
+		tsum = b1[j] + sum1; b1[j] = sum1 - 1; sum1 = tsum;
+		tsum = b2[j] + sum2; b2[j] = sum2 - 1; sum2 = tsum;
+	}
+
+	for( n = 0; n < ct; ++n )
+		buf2[++b0[buf1[n] & 0x7FF]] = buf1[n];
+
+	for( n = 0; n < ct; ++n )
+		buf1[++b1[(buf2[n] >> 11) & 0x7FF]] = buf2[n];
+
+	for( n = 0; n < ct; ++n )
+		buf2[++b2[buf1[n] >> 22]] = f4_sort_IFloatFlip( buf1[n] );
+
+	return tmp;
+}
+
+
+
 
 
 /*
@@ -430,3 +497,99 @@ void sort_qsort_dbl( ST_THR *t, int32_t ct )
 
 
 
+
+/*
+ *  MULTI-QUICKSELECT
+ *
+ *  We only ever read a handful of ranks from a sorted set - lower, upper,
+ *  median and the thresholds - so sorting all of it is mostly wasted.
+ *  Given the ranks wanted, in order, this partitions the way quickselect
+ *  does, but follows every side that still has a wanted rank in it.  The
+ *  partition is three-way, as timers tend to have lots of repeats.  Each
+ *  rank then holds the value it would have if sorted.
+ *
+ *  Like introselect, if it's making poor progress it gives up and sorts
+ *  the range, and small ranges just get sorted.
+ */
+
+#define SELECT_SMALL			16
+#define SWAP( _a, _b )			swtmp = _a; _a = _b; _b = swtmp
+
+
+static inline double sort_median3( double a, double b, double c )
+{
+	if( a < b )
+		return ( b < c ) ? b : ( ( a < c ) ? c : a );
+
+	return ( a < c ) ? a : ( ( b < c ) ? c : b );
+}
+
+
+static void sort_select_range( double *arr, int32_t lo, int32_t hi, int32_t *rk, int nr, int depth )
+{
+	int32_t lt, gt, i;
+	double p, swtmp;
+	int a, b;
+
+	while( nr > 0 )
+	{
+		if( ( hi - lo ) < SELECT_SMALL || depth-- <= 0 )
+		{
+			sort_qsort_dbl_arr( arr + lo, hi - lo + 1 );
+			return;
+		}
+
+		p = sort_median3( arr[lo], arr[lo + ( ( hi - lo ) >> 1 )], arr[hi] );
+
+		// < p, then == p, then > p
+		for( lt = lo, gt = hi, i = lo; i <= gt; )
+		{
+			if( arr[i] < p )
+			{
+				SWAP( arr[lt], arr[i] );
+				++lt;
+				++i;
+			}
+			else if( arr[i] > p )
+			{
+				SWAP( arr[i], arr[gt] );
+				--gt;
+			}
+			else
+				++i;
+		}
+
+		// ranks in the middle are already right
+		for( a = 0; a < nr && rk[a] < lt; ++a );
+		for( b = a; b < nr && rk[b] <= gt; ++b );
+
+		if( a > 0 )
+			sort_select_range( arr, lo, lt - 1, rk, a, depth );
+
+		// and carry on with the top side
+		rk += b;
+		nr -= b;
+		lo  = gt + 1;
+	}
+}
+
+
+// ranks must be in order, without repeats
+void sort_select_dbl( double *arr, int32_t ct, int32_t *ranks, int nr )
+{
+	int32_t n;
+	int depth;
+
+	if( ct < 2 )
+		return;
+
+	for( depth = 0, n = ct; n > 1; n >>= 1 )
+		depth += 2;
+
+	sort_select_range( arr, 0, ct - 1, ranks, nr, depth );
+}
+
+
+#undef SELECT_SMALL
+#undef SWAP
+
@@ -24,9 +24,27 @@
 
 
 
-PTLIST *mem_new_points( void )
+static const int16_t mem_points_sizes[PTLIST_CLASSES] =
 {
-	return (PTLIST *) mtype_new( ctl->mem->points );
+	PTLIST_SML_SIZE,
+	PTLIST_MED_SIZE,
+	PTLIST_SIZE
+};
+
+
+PTLIST *mem_new_points( int cls )
+{
+	PTLIST *p;
+
+	if( !( p = (PTLIST *) mtype_new( ctl->mem->points[cls] ) ) )
+		return NULL;
+
+	// fresh ones are zeroed, so say what they are
+	p->size    = mem_points_sizes[cls];
+	p->cls     = (int8_t) cls;
+	p->rounded = 0;
+
+	return p;
 }
 
 void mem_free_points( PTLIST **p )
@@ -41,30 +59,41 @@ void mem_free_points( PTLIST **p )
 
 	sp->count = 0;
 
-	mtype_free( ctl->mem->points, sp );
+	mtype_free( ctl->mem->points[sp->cls], sp );
 }
 
 void mem_free_points_list( PTLIST *list )
 {
-	PTLIST *p, *freed, *end;
-	int j = 0;
+	PTLIST *p, *freed[PTLIST_CLASSES], *end[PTLIST_CLASSES];
+	int c, j[PTLIST_CLASSES];
 
-	freed = NULL;
-	end   = list;
+	for( c = 0; c < PTLIST_CLASSES; ++c )
+	{
+		freed[c] = NULL;
+		end[c]   = NULL;
+		j[c]     = 0;
+	}
 
+	// each class goes back on its own free list
 	while( list )
 	{
 		p    = list;
 		list = p->next;
+		c    = p->cls;
+
+		if( !freed[c] )
+			end[c] = p;
 
 		p->count = 0;
-		p->next  = freed;
-		freed    = p;
+		p->next  = freed[c];
+		freed[c] = p;
 
-		++j;
+		++(j[c]);
 	}
 
-	mtype_free_list( ctl->mem->points, j, freed, end );
+	for( c = 0; c < PTLIST_CLASSES; ++c )
+		if( j[c] )
+			mtype_free_list( ctl->mem->points[c], j[c], freed[c], end[c] );
 }
 
 
@@ -101,6 +130,10 @@ DHASH *mem_new_dhash( const char *str, int len )
 	d->tags = "";
 	d->tlen = 0;
 
+	// names are built by whoever reports it, not carried over
+	d->names  = NULL;
+	d->ncount = 0;
+
 	return d;
 }
 
@@ -121,7 +154,11 @@ void mem_free_dhash( DHASH **d )
 	sd->in.count = 0;
 	sd->type     = 0;
 	sd->valid    = 0;
+	sd->checks   = 0;
 	sd->empty    = 0;
+	sd->seen     = 0;
+	sd->dirty    = 0;
+	sd->dnext    = NULL;
 
 	if( sd->tlen )
 	{
@@ -129,6 +166,9 @@ void mem_free_dhash( DHASH **d )
 		free( sd->base );
 	}
 
+	if( sd->names )
+		bname_free( sd );
+
 	sd->tlen = 0;
 	sd->base = NULL;
 	sd->tags = NULL;
@@ -139,6 +179,32 @@ void mem_free_dhash( DHASH **d )
 		sd->in.points = NULL;
 	}
 
+	if( sd->in.sketch )
+	{
+		sketch_free( sd->in.sketch );
+		sketch_free( sd->proc.sketch );
+		sd->in.sketch   = NULL;
+		sd->proc.sketch = NULL;
+	}
+
+	if( sd->in.res )
+	{
+		free( sd->in.res );
+		sd->in.res = NULL;
+	}
+
+	if( sd->proc.res )
+	{
+		free( sd->proc.res );
+		sd->proc.res = NULL;
+	}
+
+	if( sd->synv )
+	{
+		free( sd->synv );
+		sd->synv = NULL;
+	}
+
 	sd->proc.points = NULL;
 	sd->proc.total  = 0;
 	sd->proc.count  = 0;
@@ -169,7 +235,11 @@ void mem_free_dhash_list( DHASH *list )
 		d->type     = 0;
 		d->valid    = 0;
 		d->do_pass  = 0;
+		d->checks   = 0;
 		d->empty    = 0;
+		d->seen     = 0;
+		d->dirty    = 0;
+		d->dnext    = NULL;
 
 		if( d->tlen )
 		{
@@ -177,6 +247,9 @@ void mem_free_dhash_list( DHASH *list )
 			free( d->base );
 		}
 
+		if( d->names )
+			bname_free( d );
+
 		d->tlen = 0;
 		d->base = NULL;
 		d->tags = NULL;
@@ -191,6 +264,32 @@ void mem_free_dhash_list( DHASH *list )
 			d->in.points = NULL;
 		}
 
+		if( d->in.sketch )
+		{
+			sketch_free( d->in.sketch );
+			sketch_free( d->proc.sketch );
+			d->in.sketch   = NULL;
+			d->proc.sketch = NULL;
+		}
+
+		if( d->in.res )
+		{
+			free( d->in.res );
+			d->in.res = NULL;
+		}
+
+		if( d->proc.res )
+		{
+			free( d->proc.res );
+			d->proc.res = NULL;
+		}
+
+		if( d->synv )
+		{
+			free( d->synv );
+			d->synv = NULL;
+		}
+
 		d->proc.points = NULL;
 		d->proc.total  = 0;
 		d->proc.count  = 0;
@@ -402,12 +501,25 @@ MEMT_CTL *memt_config_defaults( void )
 
 	m = (MEMT_CTL *) mem_perm( sizeof( MEMT_CTL ) );
 
-	m->points = mem_type_declare( "points", sizeof( PTLIST ), MEM_ALLOCSZ_POINTS, 0, 1 );
+	m->points[PTLIST_CLASS_SML] = mem_type_declare( "ptsml", sizeof( PTLIST ) + PTLIST_SML_SIZE * sizeof( double ), MEM_ALLOCSZ_PTSML, 0, 1 );
+	m->points[PTLIST_CLASS_MED] = mem_type_declare( "ptmed", sizeof( PTLIST ) + PTLIST_MED_SIZE * sizeof( double ), MEM_ALLOCSZ_PTMED, 0, 1 );
+	m->points[PTLIST_CLASS_BIG] = mem_type_declare( "points", sizeof( PTLIST ) + PTLIST_SIZE * sizeof( double ), MEM_ALLOCSZ_POINTS, 0, 1 );
 	m->dhash  = mem_type_declare( "dhashs", sizeof( DHASH ),  MEM_ALLOCSZ_DHASH,  128, 1 ); // guess on path length
 	m->preds  = mem_type_declare( "preds",  sizeof( PRED ),   MEM_ALLOCSZ_PREDS,  0, 1 );
 	m->histy  = mem_type_declare( "histy",  sizeof( HIST ),   MEM_ALLOCSZ_HISTY,  480, 1 ); // guess on points
 	m->metry  = mem_type_declare( "metry",  sizeof( METRY ),  MEM_ALLOCSZ_METRY,  64, 1 );
 
+	// the ingest threads take these one at a time
+	mem_type_magazine( m->points[PTLIST_CLASS_SML], MEM_MAGSZ_PTSML );
+	mem_type_magazine( m->points[PTLIST_CLASS_MED], MEM_MAGSZ_PTMED );
+	mem_type_magazine( m->points[PTLIST_CLASS_BIG], MEM_MAGSZ_POINTS );
+	mem_type_magazine( m->dhash, MEM_MAGSZ_DHASH );
+
+	// and these are what a spike leaves lying around
+	mem_type_trimmable( m->points[PTLIST_CLASS_SML], NULL );
+	mem_type_trimmable( m->points[PTLIST_CLASS_MED], NULL );
+	mem_type_trimmable( m->points[PTLIST_CLASS_BIG], NULL );
+
 	return m;
 }
 
@@ -24,14 +24,22 @@
 #define MINISTRY_MEM_H
 
 #define MEM_ALLOCSZ_POINTS			2048
+#define MEM_ALLOCSZ_PTMED			2048
+#define MEM_ALLOCSZ_PTSML			4096
 #define MEM_ALLOCSZ_DHASH			512
 #define MEM_ALLOCSZ_PREDS			128
 #define MEM_ALLOCSZ_HISTY			128
 #define MEM_ALLOCSZ_METRY			128
 
+// thread magazines - the big points are 16k each
+#define MEM_MAGSZ_POINTS			4
+#define MEM_MAGSZ_PTMED				16
+#define MEM_MAGSZ_PTSML				32
+#define MEM_MAGSZ_DHASH				16
+
 struct memt_control
 {
-	MTYPE			*	points;
+	MTYPE			*	points[PTLIST_CLASSES];
 	MTYPE			*	dhash;
 	MTYPE			*	preds;
 	MTYPE			*	histy;
@@ -39,7 +47,18 @@ struct memt_control
 };
 
 
-PTLIST *mem_new_points( void );
+// the smallest class that holds this many, or the biggest
+static inline int mem_points_class( int64_t ct )
+{
+	if( ct <= PTLIST_SML_SIZE )
+		return PTLIST_CLASS_SML;
+	if( ct <= PTLIST_MED_SIZE )
+		return PTLIST_CLASS_MED;
+
+	return PTLIST_CLASS_BIG;
+}
+
+PTLIST *mem_new_points( int cls );
 void mem_free_points( PTLIST **p );
 void mem_free_points_list( PTLIST *list );
 
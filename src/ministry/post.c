@@ -58,6 +58,7 @@ int post_handle_finish( HTREQ *req )
 		data_parse_buf( h, b );
 
 	// then free up the host
+	data_combine_free( h );
 	mem_free_host( (HOST **) &(req->post->obj) );
 
 	strbuf_printf( req->text, "Received %ld bytes.", req->post->total );
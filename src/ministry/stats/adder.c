@@ -34,7 +34,8 @@ void stats_predict_linear( ST_THR *t, DHASH *d )
 	// these need to be reported more accurately
 	bprintf( t, "%s.lr_a %.10f", d->path, d->predict->a );
 	bprintf( t, "%s.lr_b %.10f", d->path, d->predict->b );
-	bprintf( t, "%s.fit %f", d->path, d->predict->fit );
+	bname_p( t, d, SNAME_FIT, ".fit" );
+	bput_dbl( t, d->predict->fit );
 }
 
 
@@ -51,10 +52,11 @@ void stats_predictor( ST_THR *t, DHASH *d )
 	valid = p->valid;
 
 	// report what we got
-	bprintf( t, "%s.input %f", d->path, val );
+	bname_p( t, d, SNAME_INPUT, ".input" );
+	bput_dbl( t, val );
 
 	// capture the current value
-	history_add_point( p->hist, t->tval, val );
+	maths_predict_add( p, t->tval, val );
 
 	// zero the prediction-only counter if we have a real value
 	if( p->pflag )
@@ -81,7 +83,8 @@ void stats_predictor( ST_THR *t, DHASH *d )
 	if( valid )
 	{
 		// report the diff of the previous prediction against the new value
-		bprintf( t, "%s.diff %f", d->path, ( dp_get_v( p->prediction ) - val ) );
+		bname_p( t, d, SNAME_DIFF, ".diff" );
+		bput_dbl( t, dp_get_v( p->prediction ) - val );
 	}
 
 	// calculate the next timestamp and put it in
@@ -93,7 +96,8 @@ void stats_predictor( ST_THR *t, DHASH *d )
 	(*(ctl->stats->pred->fp))( t, d );
 
 	// report our newly calculated prediction
-	bprintf( t, "%s.predict %f", d->path, dp_get_v( p->prediction ) );
+	bname_p( t, d, SNAME_PREDICT, ".predict" );
+	bput_dbl( t, dp_get_v( p->prediction ) );
 
 	// have we run the course on pcount?
 	if( p->pcount == sp->pmax )
@@ -108,105 +112,137 @@ void stats_predictor( ST_THR *t, DHASH *d )
 }
 
 
+// fill in a quiet predicted path with its prediction, if it has one
+int stats_adder_fill( DHASH *d )
+{
+	if( !dhash_do_predict( d )
+	 || !d->predict->valid
+	 || d->predict->pcount >= ctl->stats->pred->pmax )
+		return 0;
+
+	lock_adder( d );
+
+	// copy it in
+	d->proc.total = dp_get_v( d->predict->prediction );
+	debug( "Using predicted value: %f", d->proc.total );
+	d->proc.count = 1;
+	d->do_pass    = 1;
+	// mark it as having another prediction used
+	++(d->predict->pcount);
+	d->predict->pflag = 1;
+
+	unlock_adder( d );
+
+	return 1;
+}
+
+
+void stats_adder_report( ST_THR *t, DHASH *d )
+{
+	if( !d->do_pass || d->proc.count <= 0 )
+		return;
+
+	if( d->empty > 0 )
+		d->empty = 0;
+	d->seen = t->passes;
+
+	if( dhash_do_predict( d ) )
+		stats_predictor( t, d );
+	else
+	{
+		bname( t, d, SNAME_PATH, d->path, d->len, NULL, 0, NULL, 0 );
+		bput_dbl( t, d->proc.total );
+	}
+
+	// keep count and then zero it
+	t->points += d->proc.count;
+	d->proc.count = 0;
+
+	// and remove the pass marker
+	d->do_pass = 0;
+
+	++(t->active);
+}
+
+
 void stats_adder_pass( ST_THR *t )
 {
-	SYN_CTL *sc = ctl->synth;
+	DHASH *d, *n;
 	uint64_t i;
-	DHASH *d;
+	int keep;
 
 	st_thr_time( steal );
 
-	// take the data
-	for( i = 0; i < t->conf->hsize; ++i )
-		if( ( i % t->max ) == t->id )
+	// take the data, from just the paths that have some
+	for( d = stats_thread_dirty( t ); d; d = n )
+	{
+		n = d->dnext;
+
+		// synthetics are written and reported by whichever
+		// thread works them out, so we leave them be
+		if( !d->valid || dhash_is_synth( d ) )
 		{
-			for( d = t->conf->data[i]; d && d->valid; d = d->next )
-				if( d->in.count > 0 )
-				{
-					lock_adder( d );
-
-					// copy everything, then zero the in
-					d->proc     = d->in;
-					d->in.total = 0;
-					d->in.count = 0;
-					d->do_pass  = 1;
-
-					unlock_adder( d );
-				}
-				else if( dhash_do_predict( d )
-					  && d->predict->valid
-					  && d->predict->pcount < ctl->stats->pred->pmax )
-				{
-					// fill in the number using the predictor
-					lock_adder( d );
-
-					// copy it in
-					d->proc.total = dp_get_v( d->predict->prediction );
-					debug( "Using predicted value: %f", d->proc.total );
-					d->proc.count = 1;
-					d->do_pass    = 1;
-					// mark it as having another prediction used
-					++(d->predict->pcount);
-					d->predict->pflag = 1;
-
-					unlock_adder( d );
-				}
-				else if( d->empty >= 0 )
-					++(d->empty);
+			data_dirty_clear( d );
+			continue;
 		}
 
-	st_thr_time( wait );
+		// predicted paths need filling in when they get no data,
+		// so those stay on the list from pass to pass
+		keep = dhash_do_predict( d );
 
-	// say we are ready
-	lock_synth( );
-	++(sc->tready);
-	pthread_cond_signal( &(sc->threads_ready) );
-	unlock_synth( );
+		if( !keep )
+			data_dirty_clear( d );
 
-	// wait for the go
-	lock_synth( );
-	while( sc->tproceed <= 0 )
-	{
-		pthread_cond_wait( &(sc->threads_done), &(ctl->locks->synth) );
+		if( dval_count( &(d->in) ) > 0 )
+		{
+			lock_adder( d );
+
+			// copy everything, then zero the in
+			dval_steal( &(d->in), &(d->proc) );
+			d->do_pass = 1;
+
+			unlock_adder( d );
+		}
+		else if( !stats_adder_fill( d ) )
+		{
+			// nothing for a predicted path - let it go idle, unless
+			// something arrived while we were looking
+			if( keep )
+			{
+				data_dirty_clear( d );
+
+				if( dval_count( &(d->in) ) > 0 )
+					data_dirty( d );
+			}
+			continue;
+		}
+
+		stats_thread_keep( t, d );
+
+		if( keep )
+			data_dirty_push( d );
 	}
-	// decrement the counter - it hits zero once every thread has done this
-	sc->tproceed--;
-	unlock_synth( );
+
+	st_thr_time( wait );
+
+	// hand our sources to the synthetics, working
+	// out any that we were the last one in for
+	synth_arrive( t );
 
 	st_thr_time( stats );
 
 	// and report it
-	for( i = 0; i < t->conf->hsize; ++i )
-		if( ( i % t->max ) == t->id )
-			for( d = t->conf->data[i]; d && d->valid; d = d->next )
-				if( d->do_pass && d->proc.count > 0 )
-				{
-					// capture this? - needs a post-report capture mechanism
-					// lock, do all the steals, then unlock?
-					// spread the cond_signal across all steals?
-					if( d->empty > 0 )
-						d->empty = 0;
-
-					if( dhash_do_predict( d ) )
-						stats_predictor( t, d );
-					else
-						bprintf( t, "%s %f", d->path, d->proc.total );
-
-					// keep count and then zero it
-					t->points += d->proc.count;
-					d->proc.count = 0;
-
-					// and remove the pass marker
-					d->do_pass = 0;
-
-					++(t->active);
-				}
+	for( i = 0; i < t->dcount; ++i )
+		stats_adder_report( t, t->dlist[i] );
 
 	// keep track of all points
 	t->total += t->points;
 
 	// and work out how long that took
 	st_thr_time( done );
+
+	// and every so often, count the idle ones for gc
+	stats_thread_sweep( t );
 }
 
 
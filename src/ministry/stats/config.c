@@ -30,6 +30,19 @@ const char *stats_type_names[STATS_TYPE_MAX] =
 
 
 
+// work out the bucket ratio for a given relative accuracy
+static void stats_sketch_accuracy( ST_SKCH *k, double a )
+{
+	double g = ( 1 + a ) / ( 1 - a );
+
+	k->accuracy = a;
+	k->lngamma  = log( g );
+	k->lgmul    = 1 / k->lngamma;
+	k->vmul     = 2 / ( g + 1 );
+}
+
+
+
 STAT_CTL *stats_config_defaults( void )
 {
 	STAT_CTL *s;
@@ -45,6 +58,8 @@ STAT_CTL *stats_config_defaults( void )
 	s->stats->name    = stats_type_names[STATS_TYPE_STATS];
 	s->stats->hsize   = MEM_HSZ_MEDIUM;
 	s->stats->enable  = 1;
+	s->stats->hgrow   = DEFAULT_HASH_GROW;
+	s->stats->sweep   = DEFAULT_EMPTY_SWEEP;
 	stats_prefix( s->stats, DEFAULT_STATS_PREFIX );
 
 	s->adder          = (ST_CFG *) mem_perm( sizeof( ST_CFG ) );
@@ -56,6 +71,8 @@ STAT_CTL *stats_config_defaults( void )
 	s->adder->name    = stats_type_names[STATS_TYPE_ADDER];
 	s->adder->hsize   = MEM_HSZ_LARGE;
 	s->adder->enable  = 1;
+	s->adder->hgrow   = DEFAULT_HASH_GROW;
+	s->adder->sweep   = DEFAULT_EMPTY_SWEEP;
 	stats_prefix( s->adder, DEFAULT_ADDER_PREFIX );
 
 	s->gauge          = (ST_CFG *) mem_perm( sizeof( ST_CFG ) );
@@ -67,6 +84,8 @@ STAT_CTL *stats_config_defaults( void )
 	s->gauge->name    = stats_type_names[STATS_TYPE_GAUGE];
 	s->gauge->hsize   = MEM_HSZ_TINY;
 	s->gauge->enable  = 1;
+	s->gauge->hgrow   = DEFAULT_HASH_GROW;
+	s->gauge->sweep   = DEFAULT_EMPTY_SWEEP;
 	stats_prefix( s->gauge, DEFAULT_GAUGE_PREFIX );
 
 	s->histo          = (ST_CFG *) mem_perm( sizeof( ST_CFG ) );
@@ -78,6 +97,8 @@ STAT_CTL *stats_config_defaults( void )
 	s->histo->name    = stats_type_names[STATS_TYPE_HISTO];
 	s->histo->hsize   = MEM_HSZ_SMALL;
 	s->histo->enable  = 1;
+	s->histo->hgrow   = DEFAULT_HASH_GROW;
+	s->histo->sweep   = DEFAULT_EMPTY_SWEEP;
 	stats_prefix( s->histo, DEFAULT_HISTO_PREFIX );
 
 	s->self           = (ST_CFG *) mem_perm( sizeof( ST_CFG ) );
@@ -117,8 +138,27 @@ STAT_CTL *stats_config_defaults( void )
 	// fixed for now
 	s->pred->fp       = &stats_predict_linear;
 
+	// sketches are off by default
+	s->sketch          = (ST_SKCH *) mem_perm( sizeof( ST_SKCH ) );
+	s->sketch->enabled = 0;
+	s->sketch->bins    = DEFAULT_SKETCH_BINS;
+	s->sketch->rgx     = regex_list_create( 0 );
+	stats_sketch_accuracy( s->sketch, DEFAULT_SKETCH_ACCURACY );
+
+	// compact points are off by default
+	s->compact          = (ST_MOM *) mem_perm( sizeof( ST_MOM ) );
+	s->compact->enabled = 0;
+	s->compact->rgx     = regex_list_create( 0 );
+
 	// function choice threshold
 	s->qsort_thresh   = DEFAULT_QSORT_THRESHOLD;
+	s->select         = 1;
+	s->simd           = 1;
+	s->psort_thresh   = DEFAULT_PSORT_THRESHOLD;
+	s->psort_helpers  = DEFAULT_PSORT_HELPERS;
+
+	// no cap on points
+	s->max_pts        = 0;
 
 	// metrics source
 	s->metrics            = (ST_MET *) mem_perm( sizeof( ST_MET ) );
@@ -131,6 +171,10 @@ STAT_CTL *stats_config_defaults( void )
 	                                  "Number of points processed since startup by each stats thread" );
 	s->metrics->pct_time  = pmet_new( PMET_TYPE_GAUGE, "ministry_stats_thread_proc_time",
 	                                  "Percentage of available processing time used by a stats thread" );
+	s->metrics->chunks    = pmet_new( PMET_TYPE_GAUGE, "ministry_stats_chunks_current",
+	                                  "Number of chunks of paths reported this interval by each stats thread" );
+	s->metrics->steals    = pmet_new( PMET_TYPE_GAUGE, "ministry_stats_steals_current",
+	                                  "Number of chunks taken from other threads this interval by each stats thread" );
 
 	// tags - new in graphite
 	s->tags_char     = TAGS_SEPARATOR;
@@ -155,11 +199,13 @@ int stats_config_line( AVP *av )
 	ST_CFG *sc;
 	int64_t v;
 	WORDS wd;
+	double a;
 
 	if( !__stats_histcf_state )
 	{
 		memset( h, 0, sizeof( ST_HIST ) );
 		h->enabled = 1;
+		h->hbits   = DEFAULT_HDR_BITS;
 	}
 
 	if( !( d = strchr( av->aptr, '.' ) ) )
@@ -171,9 +217,13 @@ int stats_config_line( AVP *av )
 				warn( "Invalid thresholds string: %s", av->vptr );
 				return -1;
 			}
-			if( wd.wc > STATS_THRESH_MAX )
+
+			// lines add up, and each path has only so many name slots
+			for( l = 0, th = s->thresholds; th; th = th->next, ++l );
+
+			if( l + wd.wc > STATS_THRESH_MAX )
 			{
-				warn( "A maximum of %d thresholds is allowed.", STATS_THRESH_MAX );
+				warn( "A maximum of %d thresholds is allowed, across all thresholds lines.", STATS_THRESH_MAX );
 				return -1;
 			}
 
@@ -187,14 +237,14 @@ int stats_config_line( AVP *av )
 					mid = 500;
 					top = 1000;
 					lbl = "per-mille";
-					fmt = "%s_%03d";
+					fmt = ".%s_%03d";
 				}
 				else
 				{
 					mid = 50;
 					top = 100;
 					lbl = "percent";
-					fmt = "%s_%02d";
+					fmt = ".%s_%02d";
 				}
 
 				// sanity check before we go any further
@@ -212,6 +262,7 @@ int stats_config_line( AVP *av )
 				th->val = t;
 				th->max = top;
 				th->label = str_perm( thrbuf, l );
+				th->llen  = l;
 
 				th->next = s->thresholds;
 				s->thresholds = th;
@@ -245,6 +296,53 @@ int stats_config_line( AVP *av )
 				s->qsort_thresh = MIN_QSORT_THRESHOLD;
 			}
 		}
+		else if( attIs( "parallelSortThreshold" ) )
+		{
+			av_int( v );
+			s->psort_thresh = v;
+
+			// below this the hand-off costs more than it saves
+			if( s->psort_thresh < MIN_PSORT_THRESHOLD )
+			{
+				warn( "Parallel sort threshold upped to minimum of %d (from %d).", MIN_PSORT_THRESHOLD, s->psort_thresh );
+				s->psort_thresh = MIN_PSORT_THRESHOLD;
+			}
+		}
+		else if( attIs( "maxPoints" ) )
+		{
+			av_int( v );
+			s->max_pts = ( v > 0 ) ? v : 0;
+
+			if( s->max_pts && s->max_pts < MIN_MAX_POINTS )
+			{
+				warn( "Stats point cap upped to minimum of %d (from %ld).", MIN_MAX_POINTS, s->max_pts );
+				s->max_pts = MIN_MAX_POINTS;
+			}
+		}
+		else if( attIs( "sortHelpers" ) )
+		{
+			av_int( v );
+			s->psort_helpers = v;
+
+			if( s->psort_helpers < 0 )
+				s->psort_helpers = 0;
+		}
+		else if( attIs( "vectorMaths" ) )
+		{
+			s->simd = config_bool( av );
+		}
+		else if( attIs( "percentiles" ) )
+		{
+			if( !strcasecmp( av->vptr, "select" ) )
+				s->select = 1;
+			else if( !strcasecmp( av->vptr, "sort" ) )
+				s->select = 0;
+			else
+			{
+				warn( "Unrecognised percentiles method '%s' - use select or sort.", av->vptr );
+				return -1;
+			}
+		}
 		else
 			return -1;
 
@@ -282,6 +380,31 @@ int stats_config_line( AVP *av )
 
 		return 0;
 	}
+	else if( attIsN( "precision.", 10 ) )
+	{
+		av->alen -= 10;
+		av->aptr += 10;
+
+		// shortest round-trip, or a number of places
+		if( !strcasecmp( av->vptr, "shortest" ) )
+			t = -1;
+		else
+		{
+			t = (int) strtol( av->vptr, NULL, 10 );
+
+			if( t < 0 || t > RENDER_MAX_PREC )
+			{
+				warn( "Output precision must be 0 to %d, or shortest.", RENDER_MAX_PREC );
+				return -1;
+			}
+		}
+
+		if( targets_set_precision( av->aptr, t ) )
+			return -1;
+
+		debug( "Output precision for %s set to %d.", av->aptr, t );
+		return 0;
+	}
 	else if( attIsN( "moments.", 8 ) )
 	{
 		av->alen -= 8;
@@ -352,6 +475,37 @@ int stats_config_line( AVP *av )
 
 		return 0;
 	}
+	else if( attIsN( "compact.", 8 ) )
+	{
+		av->alen -= 8;
+		av->aptr += 8;
+
+		if( attIs( "enable" ) )
+		{
+			s->compact->enabled = config_bool( av );
+		}
+		else if( attIs( "fallbackMatch" ) )
+		{
+			t = config_bool( av );
+			regex_list_set_fallback( t, s->compact->rgx );
+		}
+		else if( attIs( "match" ) )
+		{
+			if( regex_list_add( av->vptr, 0, s->compact->rgx ) )
+				return -1;
+			debug( "Added compact match regex: %s", av->vptr );
+		}
+		else if( attIs( "unmatch" ) )
+		{
+			if( regex_list_add( av->vptr, 1, s->compact->rgx ) )
+				return -1;
+			debug( "Added compact unmatch regex: %s", av->vptr );
+		}
+		else
+			return -1;
+
+		return 0;
+	}
 	else if( attIsN( "predict.", 8 ) )
 	{
 		av->alen -= 8;
@@ -400,6 +554,57 @@ int stats_config_line( AVP *av )
 
 		return 0;
 	}
+	else if( attIsN( "sketch.", 7 ) )
+	{
+		av->alen -= 7;
+		av->aptr += 7;
+
+		if( attIs( "enable" ) )
+		{
+			s->sketch->enabled = config_bool( av );
+		}
+		else if( attIs( "accuracy" ) )
+		{
+			a = strtod( av->vptr, NULL );
+			if( a <= 0 || a >= 0.5 )
+			{
+				err( "Sketch accuracy must be 0 < x < 0.5, value %s given.", av->vptr );
+				return -1;
+			}
+			stats_sketch_accuracy( s->sketch, a );
+		}
+		else if( attIs( "bins" ) )
+		{
+			av_int( v );
+			if( v < SKETCH_MIN_BINS )
+			{
+				err( "Sketch bins must be at least %d.", SKETCH_MIN_BINS );
+				return -1;
+			}
+			s->sketch->bins = (int32_t) v;
+		}
+		else if( attIs( "fallbackMatch" ) )
+		{
+			t = config_bool( av );
+			regex_list_set_fallback( t, s->sketch->rgx );
+		}
+		else if( attIs( "match" ) )
+		{
+			if( regex_list_add( av->vptr, 0, s->sketch->rgx ) )
+				return -1;
+			debug( "Added sketch match regex: %s", av->vptr );
+		}
+		else if( attIs( "unmatch" ) )
+		{
+			if( regex_list_add( av->vptr, 1, s->sketch->rgx ) )
+				return -1;
+			debug( "Added sketch unmatch regex: %s", av->vptr );
+		}
+		else
+			return -1;
+
+		return 0;
+	}
 	else if( attIsN( "histogram.", 10 ) )
 	{
 		av->aptr += 10;
@@ -484,6 +689,34 @@ int stats_config_line( AVP *av )
 			// and sort those into ascending order
 			sort_qsort_dbl_arr( h->bounds, wd.wc );
 		}
+		else if( attIs( "hdrRange" ) )
+		{
+			HistCfCheck;
+
+			if( strwords( &wd, av->vptr, av->vlen, ',' ) != 2 )
+			{
+				err( "Invalid log-linear range string (want lowest, highest): %s", av->vptr );
+				return -1;
+			}
+
+			trim( &(wd.wd[0]), &(wd.len[0]) );
+			trim( &(wd.wd[1]), &(wd.len[1]) );
+			h->hlow  = strtod( wd.wd[0], NULL );
+			h->hhigh = strtod( wd.wd[1], NULL );
+			h->hdr   = 1;
+		}
+		else if( attIs( "hdrBits" ) )
+		{
+			HistCfCheck;
+
+			av_int( v );
+			if( v < 1 || v > STATS_HDR_MAX_BITS )
+			{
+				err( "Histogram log-linear bits must be between 1 and %d.", STATS_HDR_MAX_BITS );
+				return -1;
+			}
+			h->hbits = (int32_t) v;
+		}
 		else if( attIs( "match" ) )
 		{
 			HistCfCheck;
@@ -511,6 +744,18 @@ int stats_config_line( AVP *av )
 			}
 			__stats_histcf_state = 0;
 
+			if( h->hdr )
+			{
+				if( h->bounds )
+				{
+					err( "Histogram block '%s' has both bounds and a log-linear range.", h->name );
+					return -1;
+				}
+
+				if( stats_histo_hdr_bounds( h ) )
+					return -1;
+			}
+
 			if( !h->name || !h->brange || !h->rgx->count )
 			{
 				err( "Incomplete histogram block - must have a bounds list and regex matches." );
@@ -529,8 +774,15 @@ int stats_config_line( AVP *av )
 
 			// report our size
 			debug( "Histogram Config %s:", nh->name );
-			for( i = 0; i < nh->brange; ++i )
-				debug( "   %d   <=  %f", i, nh->bounds[i] );
+			if( nh->hdr )
+			{
+				debug( "   %d log-linear buckets, %d bits, %f to %f",
+					nh->brange, nh->hbits, nh->bounds[0], nh->bounds[nh->brange - 1] );
+				i = nh->brange;
+			}
+			else
+				for( i = 0; i < nh->brange; ++i )
+					debug( "   %d   <=  %f", i, nh->bounds[i] );
 			debug( "   %d  <=  +Infinity", i );
 
 			++(s->histcf_count);
@@ -580,12 +832,37 @@ int stats_config_line( AVP *av )
 		else
 			warn( "Stats offset must be > 0, value %d given.", v );
 	}
+	else if( attIs( "combine" ) )
+	{
+		if( sc->dtype != DATA_TYPE_ADDER && sc->dtype != DATA_TYPE_GAUGE )
+			warn( "Combining is only possible for adder and gauge, not %s.", sc->name );
+		else
+			sc->combine = config_bool( av );
+	}
 	else if( attIs( "size" ) || attIs( "hashSize" ) )
 	{
 		// 0 means default
 		if( !( sc->hsize = hash_size( av->vptr ) ) )
 			return -1;
 	}
+	else if( attIs( "grow" ) || attIs( "hashGrow" ) )
+	{
+		// 0 means never
+		sc->hgrow = strtod( av->vptr, NULL );
+		if( sc->hgrow < 0 )
+		{
+			warn( "Hash grow ratio must be >= 0, value %s given.", av->vptr );
+			sc->hgrow = DEFAULT_HASH_GROW;
+		}
+	}
+	else if( attIs( "sweep" ) || attIs( "emptySweep" ) )
+	{
+		av_int( v );
+		if( v > 0 )
+			sc->sweep = v;
+		else
+			warn( "Empty sweep interval must be > 0, value %d given.", v );
+	}
 	else
 		return -1;
 
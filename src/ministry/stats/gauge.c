@@ -25,53 +25,58 @@
 
 void stats_gauge_pass( ST_THR *t )
 {
+	DHASH *d, *n;
 	uint64_t i;
-	DHASH *d;
 
 	st_thr_time( steal );
 
-	// take the data
-	for( i = 0; i < t->conf->hsize; ++i )
-		if( ( i % t->max ) == t->id )
+	// take the data, from just the paths that have some
+	for( d = stats_thread_dirty( t ); d; d = n )
+	{
+		n = d->dnext;
+
+		data_dirty_clear( d );
+
+		if( d->valid && dval_count( &(d->in) ) )
 		{
-			for( d = t->conf->data[i]; d && d->valid; d = d->next )
-				if( d->in.count )
-				{
-					lock_gauge( d );
-
-					d->proc.count = d->in.count;
-					d->proc.total = d->in.total;
-					// don't reset the gauge, just the count
-					d->in.count = 0;
-
-					unlock_gauge( d );
-				}
-				else if( d->empty >= 0 )
-					++(d->empty);
+			lock_gauge( d );
+
+			// don't reset the gauge, just the count
+			dval_steal_count( &(d->in), &(d->proc) );
+
+			unlock_gauge( d );
 		}
+	}
 
 	st_thr_time( stats );
 
-	// and report it
-	for( i = 0; i < t->conf->hsize; ++i )
-		if( ( i % t->max ) == t->id )
-			for( d = t->conf->data[i]; d; d = d->next )
-			{
-				// we report gauges anyway, updated or not
-				bprintf( t, "%s %f", d->path, d->proc.total );
+	// and report it - this walks everything, so
+	// counts empty paths as it goes, without a sweep
+	for( i = 0; i < t->bcount; ++i )
+		for( d = *(t->buckets[i]); d; d = d->next )
+		{
+			// gc is done with this one, and will reap it, names and all
+			if( !d->valid )
+				continue;
+
+			// we report gauges anyway, updated or not
+			bname( t, d, SNAME_PATH, d->path, d->len, NULL, 0, NULL, 0 );
+			bput_dbl( t, d->proc.total );
 
-				if( d->proc.count )
-				{
-					if( d->empty > 0 )
-						d->empty = 0;
+			if( d->proc.count )
+			{
+				if( d->empty > 0 )
+					d->empty = 0;
 
-					// keep count and zero the counter
-					t->points += d->proc.count;
-					d->proc.count = 0;
+				// keep count and zero the counter
+				t->points += d->proc.count;
+				d->proc.count = 0;
 
-					++(t->active);
-				}
+				++(t->active);
 			}
+			else if( d->empty >= 0 )
+				++(d->empty);
+		}
 
 	// keep track of all points
 	t->total += t->points;
@@ -22,29 +22,111 @@
 #include "local.h"
 
 
+/*
+ *  Log-linear histograms, as HDR histogram does them.  Each power of two
+ *  between the lowest and highest values is split into 2^bits equal
+ *  buckets, so the bucket width is never more than 2^-bits of the
+ *  values in it.  The bucket for a value is then just the exponent and
+ *  the top mantissa bits of the double, so there is nothing to search.
+ *
+ *  Bucket 0 takes everything at or below the lowest power of two, and
+ *  the +inf count everything above the highest.  We lay out the bounds
+ *  to match, so reporting doesn't need to know which kind it has.
+ */
+int stats_histo_hdr_bounds( ST_HIST *h )
+{
+	union { double d; uint64_t u; } v;
+	int32_t emin, emax, i;
+
+	if( !( h->hlow > 0 ) || !isnormal( h->hlow ) || !isfinite( h->hhigh ) || h->hhigh <= h->hlow )
+	{
+		err( "Histogram block '%s' has an invalid log-linear range: %g to %g.",
+			h->name, h->hlow, h->hhigh );
+		return -1;
+	}
+
+	if( h->hbits < 1 || h->hbits > STATS_HDR_MAX_BITS )
+	{
+		err( "Histogram block '%s' log-linear bits must be between 1 and %d.",
+			h->name, STATS_HDR_MAX_BITS );
+		return -1;
+	}
+
+	// round the range out to powers of two
+	emin = ilogb( h->hlow );
+	emax = ilogb( h->hhigh );
+	if( ldexp( 1.0, emax ) < h->hhigh )
+		++emax;
+
+	h->brange = 1 + ( ( emax - emin ) << h->hbits );
+	h->bcount = h->brange + 1;
+
+	if( h->brange > STATS_HDR_MAX )
+	{
+		err( "Histogram block '%s' would have %d log-linear buckets - a maximum of %d is supported.",
+			h->name, h->brange, STATS_HDR_MAX );
+		return -1;
+	}
+
+	h->hshift = 52 - h->hbits;
+	h->hbase  = (uint64_t) ( emin + 1023 ) << h->hbits;
+	h->bounds = (double *) mem_perm( h->brange * sizeof( double ) );
+
+	// the upper edge of each bucket is the bottom of the next
+	for( i = 0; i < h->brange; ++i )
+	{
+		v.u = ( h->hbase + i ) << h->hshift;
+		h->bounds[i] = v.d;
+	}
+
+	return 0;
+}
+
+
+
 void stats_histo_one( ST_THR *t, DHASH *d )
 {
 	ST_HIST *c = d->proc.hist.conf;
 	DHIST *h = &(d->proc.hist);
-	int i;
+	int i, l = 1, n;
+	char sfx[32];
 
 
 	// iterate through all but one of the bounds, reporting
 	// the bounding value B, ie Val <= B
 	// but leaving off the +Inf bound
-	for( i = 0; i < c->brange; ++i )
+	sfx[0] = '.';
+
+	for( i = 0, n = SNAME_HBOUND; i < c->brange; ++i, n += 2 )
 	{
-		bprintf( t, "%s.%d.bound%s %f",   d->base, i, d->tags, c->bounds[i] );
-		bprintf( t, "%s.%d.count%s %lld", d->base, i, d->tags, h->counts[i] );
+		// log-linear ones have hundreds, mostly empty
+		if( c->hdr && !h->counts[i] )
+			continue;
+
+		// the parts are only needed the first time round
+		if( !bname_has( d, n ) )
+		{
+			l = 1 + render_int( sfx + 1, i );
+			memcpy( sfx + l, ".bound", 6 );
+		}
+		bname( t, d, n, d->base, d->blen, sfx, l + 6, d->tags, d->tlen );
+		bput_dbl( t, c->bounds[i] );
+
+		if( !bname_has( d, n + 1 ) )
+			memcpy( sfx + l, ".count", 6 );
+		bname( t, d, n + 1, d->base, d->blen, sfx, l + 6, d->tags, d->tlen );
+		bput_int( t, h->counts[i] );
 	}
 	// upper bound is +Inf, but we can't easily send that to carbon-cache
 	// without it spitting that back as 'Infinity' which is invalid JSON
 	// so we send it separately
 	// so we can't just set it as the last of the bounds
-	bprintf( t, "%s.inf.count%s %lld", d->base, d->tags, h->counts[c->brange] );
+	bname_d( t, d, SNAME_HINF, ".inf.count" );
+	bput_int( t, h->counts[c->brange] );
 
 	// number of points
-	bprintf( t, "%s.total%s %lld", d->base, d->tags, d->proc.count );
+	bname_d( t, d, SNAME_HTOTAL, ".total" );
+	bput_int( t, d->proc.count );
 
 	t->points += d->proc.count;
 
@@ -61,66 +143,74 @@ void stats_histo_one( ST_THR *t, DHASH *d )
 void stats_histo_pass( ST_THR *t )
 {
 	uint64_t i, sz;
-	DHASH *d;
+	DHASH *d, *n;
 
 	st_thr_time( steal );
 
-	// take the data
-	for( i = 0; i < t->conf->hsize; ++i )
-		if( ( i % t->max ) == t->id )
+	// take the data, from just the paths that have some
+	for( d = stats_thread_dirty( t ); d; d = n )
+	{
+		n = d->dnext;
+
+		data_dirty_clear( d );
+
+		if( d->valid && d->in.count > 0 )
 		{
-			for( d = t->conf->data[i]; d && d->valid; d = d->next )
-				if( d->in.count > 0 )
-				{
-					sz = d->in.hist.conf->bcount * sizeof( int64_t );
-					lock_histo( d );
-
-					// copy everything, then zero the in counters
-					d->proc.count = d->in.count;
-					d->in.count   = 0;
-					memcpy( d->proc.hist.counts, d->in.hist.counts, sz );
-					memset( d->in.hist.counts, 0, sz );
-					d->do_pass  = 1;
-
-					unlock_histo( d );
-				}
-				else if( d->empty >= 0 )
-					++(d->empty);
+			sz = d->in.hist.conf->bcount * sizeof( int64_t );
+			lock_histo( d );
+
+			// copy everything, then zero the in counters
+			d->proc.count = d->in.count;
+			d->in.count   = 0;
+			memcpy( d->proc.hist.counts, d->in.hist.counts, sz );
+			memset( d->in.hist.counts, 0, sz );
+			d->do_pass  = 1;
+
+			unlock_histo( d );
+
+			stats_thread_keep( t, d );
 		}
+	}
 
 	st_thr_time( wait );
 
 	st_thr_time( stats );
 
 	// and report it
-	for( i = 0; i < t->conf->hsize; ++i )
-		if( ( i % t->max ) == t->id )
-			for( d = t->conf->data[i]; d && d->valid; d = d->next )
-				if( d->do_pass && d->proc.count > 0 )
-				{
-					// capture this? - needs a post-report capture mechanism
-					// lock, do all the steals, then unlock?
-					// spread the cond_signal across all steals?
-					if( d->empty > 0 )
-						d->empty = 0;
+	for( i = 0; i < t->dcount; ++i )
+	{
+		d = t->dlist[i];
 
-					stats_histo_one( t, d );
+		if( d->do_pass && d->proc.count > 0 )
+		{
+			// capture this? - needs a post-report capture mechanism
+			// lock, do all the steals, then unlock?
+			// spread the cond_signal across all steals?
+			if( d->empty > 0 )
+				d->empty = 0;
+			d->seen = t->passes;
 
-					// keep count and then zero it
-					t->points += d->proc.count;
-					d->proc.count = 0;
+			stats_histo_one( t, d );
 
-					// and remove the pass marker
-					d->do_pass = 0;
+			// keep count and then zero it
+			t->points += d->proc.count;
+			d->proc.count = 0;
 
-					++(t->active);
-				}
+			// and remove the pass marker
+			d->do_pass = 0;
+
+			++(t->active);
+		}
+	}
 
 	// keep track of all points
 	t->total += t->points;
 
 	// and work out how long that took
 	st_thr_time( done );
+
+	// and every so often, count the idle ones for gc
+	stats_thread_sweep( t );
 }
 
 
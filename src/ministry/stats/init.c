@@ -31,6 +31,12 @@ void stats_thread_pass( int64_t tval, void *arg )
 	// set up bufs and such
 	stats_set_bufs( t, t->conf, tval );
 
+	// pick up any table changes
+	if( t->conf->data )
+		stats_thread_tables( t );
+
+	++(t->passes);
+
 	// do the work
 	(*(t->conf->statfn))( t );
 
@@ -89,6 +95,7 @@ void stats_start_one( ST_CFG *cf )
 void stats_stop_one( ST_CFG *cf )
 {
 	pthread_mutex_destroy( &(cf->statslock) );
+	pthread_mutex_destroy( &(cf->hashlock) );
 }
 
 void stats_start( void )
@@ -98,6 +105,9 @@ void stats_start( void )
 	stats_start_one( ctl->stats->gauge );
 	stats_start_one( ctl->stats->histo );
 	stats_start_one( ctl->stats->self );
+
+	if( ctl->stats->psort )
+		psort_start( ctl->stats->psort, ctl->stats->psort_helpers );
 }
 
 
@@ -132,12 +142,19 @@ void stats_init_control( ST_CFG *c, int alloc_data )
 
 	debug( "Hash size set to %d for %s", c->hsize, c->name );
 
-	// create the hash structure
+	// ownership and locking follow the starting size as it grows
+	c->hbase = c->hsize;
+
+	// create the hash structure - not perm, it may be replaced
 	if( alloc_data )
-		c->data = (DHASH **) mem_perm( c->hsize * sizeof( DHASH * ) );
+	{
+		c->data = (DHASH **) allocz( c->hsize * sizeof( DHASH * ) );
+		data_index_init( c );
+	}
 
-	// init the stats lock
+	// init the stats and hash locks
 	pthread_mutex_init( &(c->statslock), &(ctl->proc->mem->mtxa) );
+	pthread_mutex_init( &(c->hashlock),  &(ctl->proc->mem->mtxa) );
 
 	// convert msec to usec
 	c->period *= 1000;
@@ -190,12 +207,16 @@ void stats_init_control( ST_CFG *c, int alloc_data )
 		t->pm_high = pmet_create_gen( sm->pts_high,  sm->source, PMET_GEN_IVAL, &(t->highest), NULL, NULL );
 		t->pm_tot  = pmet_create_gen( sm->pts_total, sm->source, PMET_GEN_IVAL, &(t->total),   NULL, NULL );
 		t->pm_pct  = pmet_create_gen( sm->pct_time,  sm->source, PMET_GEN_DVAL, &(t->percent), NULL, NULL );
+		t->pm_chunk = pmet_create_gen( sm->chunks, sm->source, PMET_GEN_IVAL, &(t->chunks), NULL, NULL );
+		t->pm_steal = pmet_create_gen( sm->steals, sm->source, PMET_GEN_IVAL, &(t->steals), NULL, NULL );
 
 		// and apply labels
 		pmet_label_apply_item( pmet_label_words( &w ), t->pm_pts  );
 		pmet_label_apply_item( pmet_label_words( &w ), t->pm_high );
 		pmet_label_apply_item( pmet_label_words( &w ), t->pm_tot  );
 		pmet_label_apply_item( pmet_label_words( &w ), t->pm_pct  );
+		pmet_label_apply_item( pmet_label_words( &w ), t->pm_chunk );
+		pmet_label_apply_item( pmet_label_words( &w ), t->pm_steal );
 
 		//pthread_mutex_init( &(t->lock), NULL );
 
@@ -283,6 +304,14 @@ void stats_init( void )
 	ctl->stats->self->threads = 1;
 	stats_init_control( ctl->stats->self, 0 );
 
+	// vector kernels for summing, if the cpu has them
+	if( maths_simd_init( ctl->stats->simd ) )
+		info( "Using AVX2 kernels for stats maths." );
+
+	// helpers for sorting the very largest paths
+	if( ctl->stats->stats->enable && ctl->stats->psort_helpers > 0 )
+		ctl->stats->psort = psort_create( ctl->stats->psort_helpers );
+
 	// set up the http callbacks
 	http_handler_stats( &stats_self_stats_cb_stats );
 	http_handler_health( &stats_self_health_ratios );
@@ -51,6 +51,10 @@ stats_fn stats_self_stats_pass;
 
 #define DEFAULT_STATS_MSEC			10000
 
+#define DEFAULT_HASH_GROW			0.3
+#define DEFAULT_EMPTY_SWEEP			10
+#define STATS_CLAIM_CHUNK			64
+
 #define DEFAULT_STATS_PREFIX		"stats.timers."
 #define DEFAULT_ADDER_PREFIX		""
 #define DEFAULT_GAUGE_PREFIX		""
@@ -59,8 +63,12 @@ stats_fn stats_self_stats_pass;
 
 #define DEFAULT_MOM_MIN				30L
 #define DEFAULT_MODE_MIN			30L
+#define DEFAULT_SKETCH_ACCURACY		0.01
+#define DEFAULT_SKETCH_BINS			2048
 
 #define TSBUF_SZ					32
+#define RENDER_VAL_SZ				32
+#define RENDER_MAX_PREC				15
 #define PREFIX_SZ					512
 #define PATH_SZ						8192
 
@@ -68,23 +76,78 @@ stats_fn stats_self_stats_pass;
 
 
 
+// which cached name each output line uses
+enum stats_name_slots
+{
+	// stats
+	SNAME_COUNT = 0,
+	SNAME_MEAN,
+	SNAME_UPPER,
+	SNAME_LOWER,
+	SNAME_MEDIAN,
+	SNAME_STDDEV,
+	SNAME_SKEW,
+	SNAME_KURT,
+	SNAME_MODE,
+	SNAME_MODE_CT,
+	SNAME_THRESH,
+	SNAME_STATS_MAX = SNAME_THRESH + STATS_THRESH_MAX,
+
+	// adders and gauges
+	SNAME_PATH = 0,
+	SNAME_INPUT,
+	SNAME_DIFF,
+	SNAME_PREDICT,
+	SNAME_FIT,
+	SNAME_ADDER_MAX,
+
+	// histograms - then a bound and a count for each
+	SNAME_HINF = 0,
+	SNAME_HTOTAL,
+	SNAME_HBOUND
+};
+
+
 struct stat_threshold
 {
 	ST_THOLD		*	next;
 	int					val;
 	int					max;
-	char			*	label;
+	int					llen;
+	char			*	label;	// with the leading dot
 };
 
 
 
 // render
 void bprintf( ST_THR *t, char *fmt, ... );
+void bname( ST_THR *t, DHASH *d, int slot, const char *a, int al, const char *b, int bl, const char *c, int cl );
+void bput_dbl( ST_THR *t, double v );
+void bput_int( ST_THR *t, int64_t v );
+int render_uint( char *p, uint64_t v );
+int render_int( char *p, int64_t v );
+int render_dbl( char *p, double v, int prec );
+
+// base, a literal suffix, then tags
+#define bname_d( _t, _d, _n, _s )	bname( _t, _d, _n, _d->base, _d->blen, _s, sizeof( _s ) - 1, _d->tags, _d->tlen )
+// the whole path, then a literal suffix
+#define bname_p( _t, _d, _n, _s )	bname( _t, _d, _n, _d->path, _d->len, _s, sizeof( _s ) - 1, NULL, 0 )
+// do we need to bother making the parts?
+#define bname_has( _d, _n )			( _d->names && _d->names[_n].str )
 
 // utils
 void stats_prefix( ST_CFG *c, char *s );
 void stats_set_workspace( ST_THR *t, int32_t len );
 void stats_set_bufs( ST_THR *t, ST_CFG *c, int64_t tval );
+void stats_thread_tables( ST_THR *t );
+DHASH *stats_thread_dirty( ST_THR *t );
+void stats_thread_keep( ST_THR *t, DHASH *d );
+void stats_thread_publish( ST_THR *t, int64_t heavy );
+void stats_thread_share( ST_THR *t, claim_fn *fp );
+void stats_thread_sweep( ST_THR *t );
+
+// histo
+int stats_histo_hdr_bounds( ST_HIST *h );
 
 // self
 float stats_self_report_hash_ratio( ST_CFG *c );
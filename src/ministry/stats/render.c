@@ -24,6 +24,222 @@
 
 
 
+/*
+ *  Every line we send used to go through vsnprintf, with %f, which was
+ *  one of the slower parts of a stats pass and always wrote six places
+ *  - 12.000000 - to every target.  The data paths now pick a name and
+ *  hand over the value as a number, which each target set formats to
+ *  its type's precision.  Trailing zeros are dropped, so the value is
+ *  the same as before but usually shorter.
+ *
+ *  A negative precision asks for the shortest text that reads back as
+ *  the same double.  That is a plain ladder of %g precisions checked
+ *  with strtod - it's slow, but it's the unusual case.  Any double with
+ *  a 15 digit or shorter form gets it from %.15g, so the ladder starts
+ *  there, except for subnormals, which start at one digit.
+ *
+ *  bprintf is kept for self-stats and anything else low volume.
+ */
+
+
+static const char render_pairs[201] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+static const double render_pow10[RENDER_MAX_PREC + 1] =
+{
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8,
+	1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15
+};
+
+
+__attribute__((hot)) int render_uint( char *p, uint64_t v )
+{
+	char tmp[24], *q = tmp + 24;
+	int i, l;
+
+	// two digits at a time
+	while( v >= 100 )
+	{
+		i   = (int) ( v % 100 ) << 1;
+		v  /= 100;
+		*--q = render_pairs[i + 1];
+		*--q = render_pairs[i];
+	}
+
+	if( v >= 10 )
+	{
+		i   = (int) v << 1;
+		*--q = render_pairs[i + 1];
+		*--q = render_pairs[i];
+	}
+	else
+		*--q = '0' + (char) v;
+
+	l = tmp + 24 - q;
+	memcpy( p, q, l );
+
+	return l;
+}
+
+
+__attribute__((hot)) int render_int( char *p, int64_t v )
+{
+	if( v < 0 )
+	{
+		*p = '-';
+		return 1 + render_uint( p + 1, -( (uint64_t) v ) );
+	}
+
+	return render_uint( p, (uint64_t) v );
+}
+
+
+// for anything the fast path can't hold
+static int render_dbl_slow( char *p, double v, int prec )
+{
+	int l;
+
+	// %f of something huge won't fit, and isn't much use
+	if( isfinite( v ) && fabs( v ) >= 9.0e18 )
+		prec = -1;
+
+	if( prec < 0 )
+	{
+		// no -0
+		if( v == 0 )
+		{
+			*p = '0';
+			return 1;
+		}
+
+		// fifteen digits always read back the same, except for
+		// subnormals, which have fewer to give
+		for( prec = ( fabs( v ) < DBL_MIN ) ? 1 : 15; prec < 17; ++prec )
+		{
+			l = snprintf( p, RENDER_VAL_SZ, "%.*g", prec, v );
+			if( strtod( p, NULL ) == v )
+				return l;
+		}
+
+		return snprintf( p, RENDER_VAL_SZ, "%.17g", v );
+	}
+
+	l = snprintf( p, RENDER_VAL_SZ, "%.*f", prec, v );
+
+	if( isfinite( v ) && memchr( p, '.', l ) )
+	{
+		while( p[l - 1] == '0' )
+			--l;
+		if( p[l - 1] == '.' )
+			--l;
+	}
+
+	return l;
+}
+
+
+// fixed places, less any trailing zeros
+__attribute__((hot)) int render_dbl( char *p, double v, int prec )
+{
+	uint64_t ip, fp, m;
+	double f, r, h;
+	char *q = p;
+	int i;
+
+	if( prec < 0 || !isfinite( v ) )
+		return render_dbl_slow( p, v, prec );
+
+	if( prec > RENDER_MAX_PREC )
+		prec = RENDER_MAX_PREC;
+
+	if( v < 0 )
+	{
+		*q++ = '-';
+		v    = -v;
+	}
+
+	// the whole part has to fit in 64 bits
+	if( v >= 9.0e18 )
+		return render_dbl_slow( p, ( p == q ) ? v : -v, prec );
+
+	// taking the whole part off leaves the fraction exact,
+	// so scaling it rounds just once
+	m  = (uint64_t) render_pow10[prec];
+	ip = (uint64_t) v;
+	v -= (double) ip;
+	f  = v * render_pow10[prec];
+	r  = floor( f );
+	fp = (uint64_t) r;
+
+	// on what looks like a tie, the rounding error of that
+	// multiply says which way it really goes - else even
+	if( ( f - r ) == 0.5 )
+		h = fma( v, render_pow10[prec], -f );
+	else
+		h = ( f - r ) - 0.5;
+
+	// even means the last digit we keep, which at no places is
+	// the whole part's
+	if( h > 0 || ( h == 0 && ( ( prec ? fp : ip ) & 0x1 ) ) )
+	{
+		if( ++fp == m )
+		{
+			fp = 0;
+			++ip;
+		}
+	}
+
+	// no -0
+	if( !ip && !fp )
+		q = p;
+
+	q += render_uint( q, ip );
+
+	if( fp )
+	{
+		// drop the trailing zeros first
+		for( ; !( fp % 10 ); fp /= 10, --prec );
+
+		*q++ = '.';
+		for( i = prec - 1; i >= 0; --i, fp /= 10 )
+			q[i] = '0' + (char) ( fp % 10 );
+
+		q += prec;
+	}
+
+	return q - p;
+}
+
+
+
+// make sure there's room in this target set's buffer
+__attribute__((hot)) static inline IOBUF *bspace( ST_THR *t, int i, int total )
+{
+	// are we ready for a new buffer?
+	if( !buf_hasspace( t->bp[i]->bf, total ) )
+	{
+		io_buf_post( ctl->tgt->setarr[i]->targets, t->bp[i] );
+
+		if( !( t->bp[i] = mem_new_iobuf( IO_BUF_SZ ) ) )
+		{
+			fatal( "Could not allocate a new IOBUF." );
+			return NULL;
+		}
+	}
+
+	return t->bp[i];
+}
+
+
 // a little caution so we cannot write off the
 // end of the buffer
 void bprintf( ST_THR *t, char *fmt, ... )
@@ -31,7 +247,7 @@ void bprintf( ST_THR *t, char *fmt, ... )
 	int i, total;
 	va_list args;
 	uint32_t l;
-	TSET *s;
+	IOBUF *b;
 
 	// write the variable part into the thread's path buffer
 	va_start( args, fmt );
@@ -50,27 +266,134 @@ void bprintf( ST_THR *t, char *fmt, ... )
 	// loop through the target sets, making sure we can
 	// send to them
 	for( i = 0; i < ctl->tgt->set_count; ++i )
+		if( ( b = bspace( t, i, total ) ) )
+			(*(ctl->tgt->setarr[i]->type->wrfp))( t, t->ts[i], b );
+}
+
+
+
+/*
+ *  Each path keeps the full names it reports under - prefix, base,
+ *  suffix and tags - built the first time each one is used.  After
+ *  that a line is the cached name, the value and the timestamp,
+ *  copied straight into each target set's buffer by its type's line
+ *  function.
+ *
+ *  Only whoever is reporting a path touches its names, and they go
+ *  when the path is freed.
+ */
+
+static inline uint16_t bname_count( DHASH *d )
+{
+	switch( d->type )
 	{
-		s = ctl->tgt->setarr[i];
+		case DATA_TYPE_STATS:
+			return SNAME_STATS_MAX;
+		case DATA_TYPE_HISTO:
+			return SNAME_HBOUND + 2 * d->proc.hist.conf->brange;
+		default:
+			return SNAME_ADDER_MAX;
+	}
+}
+
+
+// pick the name for this slot, building it from the parts if need be
+__attribute__((hot)) void bname( ST_THR *t, DHASH *d, int slot, const char *a, int al, const char *b, int bl, const char *c, int cl )
+{
+	DNAME *n;
+	char *p;
+
+	if( !d->names )
+	{
+		d->ncount = bname_count( d );
+		if( !( d->names = (DNAME *) allocz( d->ncount * sizeof( DNAME ) ) ) )
+			fatal( "Could not allocate name slots for %s.", d->path );
+	}
+
+	n = d->names + slot;
+
+	if( !n->str )
+	{
+		n->len = t->prefix->len + al + bl + cl;
+		if( !( n->str = p = (char *) allocz( n->len + 1 ) ) )
+			fatal( "Could not allocate a name for %s.", d->path );
 
-		// are we ready for a new buffer?
-		if( !buf_hasspace( t->bp[i]->bf, total ) )
+		memcpy( p, t->prefix->buf, t->prefix->len );
+		p += t->prefix->len;
+		memcpy( p, a, al );
+		p += al;
+
+		if( bl )
 		{
-			io_buf_post( s->targets, t->bp[i] );
+			memcpy( p, b, bl );
+			p += bl;
+		}
+		if( cl )
+			memcpy( p, c, cl );
+	}
+
+	t->name = n;
+}
+
+
+void bname_free( DHASH *d )
+{
+	uint16_t i;
+
+	for( i = 0; i < d->ncount; ++i )
+		if( d->names[i].str )
+			free( d->names[i].str );
+
+	free( d->names );
+
+	d->names  = NULL;
+	d->ncount = 0;
+}
+
+
+
+// add the value, as each target set wants it, and send
+__attribute__((hot)) static inline void bvalue( ST_THR *t, double dv, int64_t iv, int isint )
+{
+	int i, prec = 0, total, vl = 0;
+	char v[RENDER_VAL_SZ];
+	TSET *s;
+	IOBUF *b;
+
+	if( isint )
+		vl = render_int( v, iv );
+
+	total = t->name->len + RENDER_VAL_SZ + TSBUF_SZ + TARGETS_LINE_EXTRA;
+
+	for( i = 0; i < ctl->tgt->set_count; ++i )
+	{
+		s = ctl->tgt->setarr[i];
 
-			if( !( t->bp[i] = mem_new_iobuf( IO_BUF_SZ ) ) )
-			{
-				fatal( "Could not allocate a new IOBUF." );
-				return;
-			}
+		// sets of the same type run together
+		if( !isint && ( i == 0 || s->type->prec != prec ) )
+		{
+			prec = s->type->prec;
+			vl   = render_dbl( v, dv, prec );
 		}
 
-		// so write out the new data
-		(*(s->type->wrfp))( t, t->ts[i], t->bp[i] );
+		if( ( b = bspace( t, i, total ) ) )
+			(*(s->type->lnfp))( b, t->name->str, t->name->len, v, vl, t->ts[i] );
 	}
 }
 
 
+__attribute__((hot)) void bput_dbl( ST_THR *t, double v )
+{
+	bvalue( t, v, 0, 0 );
+}
+
+
+__attribute__((hot)) void bput_int( ST_THR *t, int64_t v )
+{
+	bvalue( t, 0, v, 1 );
+}
+
+
 
 // TIMESTAMP FUNCTIONS
 void stats_tsf_sec( ST_THR *t, BUF *b )
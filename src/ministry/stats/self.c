@@ -23,10 +23,46 @@
 
 
 
+// most threads to report magazines for, per type
+#define SELF_MAG_THREADS	256
+
 #define __srmt_ct( n, c )	\
 		bprintf( t, "mem.trace.%s.%s.calls %ld", ms.name, n, c.ctr ); \
 		bprintf( t, "mem.trace.%s.%s.total %ld", ms.name, n, c.sum )
 
+void stats_self_report_mags( ST_THR *t, int16_t id, MTSTAT *ms )
+{
+	MTMTS thr[SELF_MAG_THREADS];
+	int64_t calls;
+	char *p;
+	int j, n;
+
+	calls = ms->mag.hits + ms->mag.misses;
+
+	bprintf( t, "mem.%s.mag.hits %ld",      ms->name, ms->mag.hits );
+	bprintf( t, "mem.%s.mag.misses %ld",    ms->name, ms->mag.misses );
+	bprintf( t, "mem.%s.mag.spills %ld",    ms->name, ms->mag.spills );
+	bprintf( t, "mem.%s.mag.cached %ld",    ms->name, ms->mag.cached );
+	bprintf( t, "mem.%s.mag.threads %d",    ms->name, ms->mag_threads );
+	bprintf( t, "mem.%s.mag.hit_ratio %.6f", ms->name, ( calls ) ? (double) ms->mag.hits / (double) calls : 0.0 );
+
+	n = mem_type_mag_stats( id, thr, SELF_MAG_THREADS );
+
+	for( j = 0; j < n; ++j )
+	{
+		// thread names can have anything in them
+		for( p = thr[j].name; *p; ++p )
+			if( !isalnum( *p ) && *p != '_' && *p != '-' )
+				*p = '_';
+
+		calls = thr[j].ctrs.hits + thr[j].ctrs.misses;
+
+		bprintf( t, "mem.%s.mag.thread.%s.hit_ratio %.6f", ms->name, thr[j].name,
+			(double) thr[j].ctrs.hits / (double) calls );
+	}
+}
+
+
 void stats_self_report_mtypes( ST_THR *t )
 {
 	MTSTAT ms;
@@ -48,6 +84,12 @@ void stats_self_report_mtypes( ST_THR *t )
 		bprintf( t, "mem.trace.%s.unfreed %ld",  ms.name, ( ms.ctrs.all.sum - ms.ctrs.fre.sum ) );
 #endif
 		bprintf( t, "mem.%s.kb %lu",   ms.name, ms.bytes / 1024 );
+
+		if( ms.trim )
+			bprintf( t, "mem.%s.trimmed_kb %ld", ms.name, ms.trimmed / 1024 );
+
+		if( ms.mag_size )
+			stats_self_report_mags( t, i, &ms );
 	}
 }
 
@@ -71,6 +113,10 @@ void stats_self_report_types( ST_THR *t, ST_CFG *c )
 	bprintf( t, "paths.%s.creates %lu",       c->name, lockless_fetch( &(c->creates) ) );
 	bprintf( t, "paths.%s.creates_total %lu", c->name, c->creates.count );
 	bprintf( t, "paths.%s.hash_ratio %.6f",   c->name, hr );
+	bprintf( t, "paths.%s.hash_size %lu",     c->name, c->hsize );
+	bprintf( t, "paths.%s.hash_resizes %ld",  c->name, c->resizes );
+	bprintf( t, "paths.%s.index_size %lu",    c->name, c->index->size );
+	bprintf( t, "paths.%s.index_used %lu",    c->name, c->index->used );
 }
 
 
@@ -80,18 +126,48 @@ void stats_self_report_types( ST_THR *t, ST_CFG *c )
 void stats_self_report_netport( ST_THR *t, NET_PORT *p, char *name, char *proto, int do_drops )
 {
 	uint64_t diff;
+	char pn[16];
+
+	// reuseport sockets share a port number
+	if( p->sock )
+		snprintf( pn, 16, "%hu_%hu", p->port, p->sock );
+	else
+		snprintf( pn, 16, "%hu", p->port );
 
 	diff = lockless_fetch( &(p->errors)  );
-	bprintf( t, "network.%s.%s.%hu.errors %lu",  name, proto, p->port, diff );
+	bprintf( t, "network.%s.%s.%s.errors %lu",  name, proto, pn, diff );
 
 	if( do_drops )
 	{
 		diff = lockless_fetch( &(p->drops)   );
-		bprintf( t, "network.%s.%s.%hu.drops %lu",   name, proto, p->port, diff );
+		bprintf( t, "network.%s.%s.%s.drops %lu",   name, proto, pn, diff );
 	}
 
 	diff = lockless_fetch( &(p->accepts) );
-	bprintf( t, "network.%s.%s.%hu.accepts %lu", name, proto, p->port, diff );
+	bprintf( t, "network.%s.%s.%s.accepts %lu", name, proto, pn, diff );
+}
+
+
+// batch fill tells us how hard the udp socket is being pushed
+void stats_self_report_udpbatch( ST_THR *t, NET_PORT *p, char *name )
+{
+	uint64_t batches, rcvd, full;
+	char pn[16];
+	double fill;
+
+	batches = lockless_fetch( &(p->batches) );
+	rcvd    = lockless_fetch( &(p->rcvd)    );
+	full    = lockless_fetch( &(p->bfull)   );
+	fill    = ( batches ) ? (double) rcvd / (double) batches : 0;
+
+	if( p->sock )
+		snprintf( pn, 16, "%hu_%hu", p->port, p->sock );
+	else
+		snprintf( pn, 16, "%hu", p->port );
+
+	bprintf( t, "network.%s.udp.%s.batches %lu",    name, pn, batches );
+	bprintf( t, "network.%s.udp.%s.batch_full %lu", name, pn, full );
+	bprintf( t, "network.%s.udp.%s.batch_fill %.3f", name, pn, fill );
 }
 
 
@@ -111,7 +187,10 @@ void stats_self_report_nettype( ST_THR *t, NET_TYPE *n )
 
 	if( n->flags & NTYPE_UDP_ENABLED )
 		for( i = 0; i < n->udp_count; ++i )
+		{
 			stats_self_report_netport( t, n->udp[i], n->name, "udp", drops );
+			stats_self_report_udpbatch( t, n->udp[i], n->name );
+		}
 }
 
 
@@ -131,6 +210,14 @@ void stats_self_stats_pass( ST_THR *t )
 	stats_self_report_types( t, ctl->stats->gauge );
 	stats_self_report_types( t, ctl->stats->histo );
 
+	// parallel sorting
+	if( ctl->stats->psort )
+	{
+		bprintf( t, "sort.parallel.count %lu", lockless_fetch( &(ctl->stats->psort->uses) ) );
+		bprintf( t, "sort.parallel.usec %lu",  lockless_fetch( &(ctl->stats->psort->usec) ) );
+		bprintf( t, "sort.parallel.busy %lu",  lockless_fetch( &(ctl->stats->psort->busy) ) );
+	}
+
 	// memory
 	stats_self_report_mtypes( t );
 
@@ -161,7 +248,20 @@ void stats_thread_report( ST_THR *t )
 	bprintf( t, "%s.total %ld",  t->wkrstr, t->total  );
 
 	if( t->conf->type == STATS_TYPE_STATS )
+	{
 		bprintf( t, "%s.workspace %d", t->wkrstr, t->wkspcsz );
+		bprintf( t, "%s.chunks %ld",   t->wkrstr, t->chunks );
+		bprintf( t, "%s.steals %ld",   t->wkrstr, t->steals );
+
+		if( ctl->stats->compact->enabled )
+		{
+			bprintf( t, "%s.compact %ld",       t->wkrstr, t->compact );
+			bprintf( t, "%s.compact_exact %ld", t->wkrstr, t->cexact );
+		}
+
+		if( ctl->stats->max_pts )
+			bprintf( t, "%s.capped %ld", t->wkrstr, t->capped );
+	}
 
 	if( t->conf->type == STATS_TYPE_STATS
 	 || t->conf->type == STATS_TYPE_HISTO )
@@ -223,6 +323,7 @@ void stats_self_report_http_types( json_object *js, ST_CFG *c )
 
 	json_insert( jt, "curr",      double, c->dcurr );
 	json_insert( jt, "hashRatio", double, hr );
+	json_insert( jt, "hashSize",  int64,  c->hsize );
 
 	json_insert( jc, "curr",      int64, lockless_fetch( &(c->gc_count) ) );
 	json_insert( jc, "total",     int64, c->gc_count.count );
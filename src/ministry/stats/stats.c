@@ -37,9 +37,12 @@ void stats_report_moments( ST_THR *t, DHASH *d, int64_t ct, double mean )
 
 	maths_moments( &m );
 
-	bprintf( t, "%s.stddev%s %f",   d->base, d->tags, m.sdev );
-	bprintf( t, "%s.skewness%s %f", d->base, d->tags, m.skew );
-	bprintf( t, "%s.kurtosis%s %f", d->base, d->tags, m.kurt );
+	bname_d( t, d, SNAME_STDDEV, ".stddev" );
+	bput_dbl( t, m.sdev );
+	bname_d( t, d, SNAME_SKEW, ".skewness" );
+	bput_dbl( t, m.skew );
+	bname_d( t, d, SNAME_KURT, ".kurtosis" );
+	bput_dbl( t, m.kurt );
 }
 
 
@@ -76,8 +79,10 @@ void stats_report_mode( ST_THR *t, DHASH *d, int64_t ct )
 
 	if( mdmx > 1 )
 	{
-		bprintf( t, "%s.mode%s %f",    d->base, d->tags, mode );
-		bprintf( t, "%s.mode_ct%s %f", d->base, d->tags, mdmx );
+		bname_d( t, d, SNAME_MODE, ".mode" );
+		bput_dbl( t, mode );
+		bname_d( t, d, SNAME_MODE_CT, ".mode_ct" );
+		bput_dbl( t, (double) mdmx );
 	}
 }
 
@@ -101,17 +106,151 @@ void __report_array( double *arr, int64_t ct )
 }
 
 
+// sketched paths report the same, but have no points for moments or mode
+void stats_report_sketch( ST_THR *t, DHASH *d )
+{
+	SKETCH *s = d->proc.sketch;
+	ST_THOLD *thr;
+	int64_t ct;
+	int j;
+
+	if( ( ct = s->count ) == 0 )
+		return;
+
+	bname_d( t, d, SNAME_COUNT, ".count" );
+	bput_int( t, ct );
+	bname_d( t, d, SNAME_MEAN, ".mean" );
+	bput_dbl( t, s->sum / (double) ct );
+	bname_d( t, d, SNAME_UPPER, ".upper" );
+	bput_dbl( t, s->max );
+	bname_d( t, d, SNAME_LOWER, ".lower" );
+	bput_dbl( t, s->min );
+	bname_d( t, d, SNAME_MEDIAN, ".median" );
+	bput_dbl( t, sketch_value( s, ct / 2 ) );
+
+	// variable thresholds, at the same ranks as a sort would use
+	for( j = SNAME_THRESH, thr = ctl->stats->thresholds; thr; thr = thr->next, ++j )
+	{
+		bname( t, d, j, d->base, d->blen, thr->label, thr->llen, d->tags, d->tlen );
+		bput_dbl( t, sketch_value( s, ( thr->val * ct ) / thr->max ) );
+	}
+
+	// synthetics may read this path
+	if( d->synv )
+		synth_stats_publish( d, t->tval, (double) ct, s->sum / (double) ct, s->max, s->min, sketch_value( s, ct / 2 ) );
+
+	sketch_reset( s );
+
+	// keep count
+	t->points += ct;
+
+	// and keep highest
+	if( ct > t->highest )
+		t->highest = ct;
+
+	// and keep track of active
+	++(t->active);
+}
+
+
+// Work out which ranks we report, in order, so selection can find
+// just those.  Returns 0 if there are somehow too many thresholds.
+static inline int stats_report_ranks( int32_t *rk, int64_t ct )
+{
+	ST_THOLD *thr;
+	int n, i, j;
+	int32_t r;
+
+	rk[0] = ct / 2;
+	n     = 1;
+
+	for( thr = ctl->stats->thresholds; thr; thr = thr->next )
+	{
+		if( n > STATS_THRESH_MAX )
+			return 0;
+
+		r = ( thr->val * ct ) / thr->max;
+
+		// keep them in order, without repeats
+		for( i = 0; i < n && rk[i] < r; ++i );
+
+		if( i < n && rk[i] == r )
+			continue;
+
+		for( j = n; j > i; --j )
+			rk[j] = rk[j - 1];
+
+		rk[i] = r;
+		++n;
+	}
+
+	return n;
+}
+
+
+// Compact paths hold floats.  Gather them in the second buffer, which
+// has room for them and the radix sort's scratch space, then widen them
+// into the first.  If we'd be sorting a big set anyway, sort them while
+// they're floats, at half the bandwidth, and say so.
+static int stats_compact_points( ST_THR *t, DHASH *d, PTLIST *list, int64_t ct )
+{
+	int exact = 1, sorted = 0;
+	PTLIST *p;
+	int64_t i;
+	float *f;
+
+	stats_set_workspace( t, ct );
+
+	f = (float *) t->wkbuf2;
+
+	for( i = 0, p = list; p; p = p->next )
+	{
+		memcpy( f + i, p->vals, p->count * sizeof( float ) );
+		i += p->count;
+
+		if( p->rounded )
+			exact = 0;
+	}
+
+	// selection works on the doubles
+	if( ct >= ctl->stats->qsort_thresh
+	 && ( !ctl->stats->select || dhash_do_mode( d ) ) )
+	{
+		f = sort_radix11_flt( t, f, f + ct, (int32_t) ct );
+		sorted = 1;
+	}
+
+	for( i = 0; i < ct; ++i )
+		t->wkbuf1[i] = (double) f[i];
+
+	t->wkspc = t->wkbuf1;
+
+	++(t->compact);
+	if( exact )
+		++(t->cexact);
+
+	return sorted;
+}
+
+
 void stats_report_one( ST_THR *t, DHASH *d )
 {
-	int64_t i, ct, idx;
-	double sum, mean;
+	int32_t ranks[STATS_THRESH_MAX + 1];
+	double sum, mean, lower, upper;
+	int64_t i, ct, idx, all;
+	int nr = 0, j, sorted = 0;
 	PTLIST *list, *p;
 	ST_THOLD *thr;
+	DRES *res;
 
 	// grab the points list
 	list = d->proc.points;
 	d->proc.points = NULL;
 
+	// and the sample, if it went past the cap
+	res = d->proc.res;
+	d->proc.res = NULL;
+
 #ifdef CATCH_HIGH_POINTERS
 	// weird pointer corruption check
 	if( ((unsigned long) list) & 0xfff0000000000000 )
@@ -123,13 +262,18 @@ void stats_report_one( ST_THR *t, DHASH *d )
 #endif
 
 	// anything to do?
-	if( ( ct = (int32_t) d->proc.count ) == 0 )
+	if( ( all = d->proc.count ) == 0 )
 	{
 		if( list )
 			mem_free_points_list( list );
+		if( res )
+			free( res );
 		return;
 	}
 
+	// we only have the sample to work with
+	ct = ( res ) ? res->kept : all;
+
 	// if we have just one points structure, we just use
 	// it's own vals array as our workspace.  We need to
 	// sort in place, but only this fn holds that space
@@ -137,7 +281,9 @@ void stats_report_one( ST_THR *t, DHASH *d )
 	// need a flat array, so make sure the workbuf is big
 	// enough and copy each vals array into it
 
-	if( list->next == NULL )
+	if( dhash_do_compact( d ) )
+		sorted = stats_compact_points( t, d, list, ct );
+	else if( list->next == NULL )
 		t->wkspc = list->vals;
 	else
 	{
@@ -156,34 +302,85 @@ void stats_report_one( ST_THR *t, DHASH *d )
 	}
 
 	sum = 0;
-	maths_kahan_summation( t->wkspc, ct, &sum );
+
+	if( sorted )
+	{
+		maths_kahan_summation( t->wkspc, ct, &sum );
+
+		lower = t->wkspc[0];
+		upper = t->wkspc[ct-1];
+	}
+	// mode needs them in order, otherwise we can just select
+	// the ranks we report, and find the ends while summing
+	else if( ctl->stats->select && !dhash_do_mode( d )
+	 && ( nr = stats_report_ranks( ranks, ct ) ) > 0 )
+	{
+		maths_kahan_summation_range( t->wkspc, ct, &sum, &lower, &upper );
+		sort_select_dbl( t->wkspc, (int32_t) ct, ranks, nr );
+	}
+	else
+	{
+		maths_kahan_summation( t->wkspc, ct, &sum );
+
+		// and sort them - the biggest get help if it's free
+		if( ct >= ctl->stats->psort_thresh && ctl->stats->psort )
+		{
+			// that's many lists, so we're in wkbuf1 and wkbuf2 is free
+			if( psort_dbl( ctl->stats->psort, t->wkspc, t->wkbuf2, (int32_t) ct ) == 0 )
+				t->wkspc = t->wkbuf2;
+			else
+				sort_radix11( t, (int32_t) ct );
+		}
+		else if( ct < ctl->stats->qsort_thresh )
+			sort_qsort_dbl( t, (int32_t) ct );
+		else
+			sort_radix11( t, (int32_t) ct );
+
+		lower = t->wkspc[0];
+		upper = t->wkspc[ct-1];
+	}
+
+	// but the count, mean and ends are still exact
+	if( res )
+	{
+		sum   = res->total;
+		lower = res->min;
+		upper = res->max;
+
+		free( res );
+		++(t->capped);
+	}
 
 	// median offset
 	idx = ct / 2;
 
 	// and the mean
-	mean = sum / (double) ct;
-
-	// and sort them
-	if( ct < ctl->stats->qsort_thresh )
-		sort_qsort_dbl( t, (int32_t) ct );
-	else
-		sort_radix11( t, (int32_t) ct );
-
-	bprintf( t, "%s.count%s %d",  d->base, d->tags, ct );
-	bprintf( t, "%s.mean%s %f",   d->base, d->tags, mean );
-	bprintf( t, "%s.upper%s %f",  d->base, d->tags, t->wkspc[ct-1] );
-	bprintf( t, "%s.lower%s %f",  d->base, d->tags, t->wkspc[0] );
-	bprintf( t, "%s.median%s %f", d->base, d->tags, t->wkspc[idx] );
+	mean = sum / (double) all;
+
+	bname_d( t, d, SNAME_COUNT, ".count" );
+	bput_int( t, all );
+	bname_d( t, d, SNAME_MEAN, ".mean" );
+	bput_dbl( t, mean );
+	bname_d( t, d, SNAME_UPPER, ".upper" );
+	bput_dbl( t, upper );
+	bname_d( t, d, SNAME_LOWER, ".lower" );
+	bput_dbl( t, lower );
+	bname_d( t, d, SNAME_MEDIAN, ".median" );
+	bput_dbl( t, t->wkspc[idx] );
 
 	// variable thresholds
-	for( thr = ctl->stats->thresholds; thr; thr = thr->next )
+	for( j = SNAME_THRESH, thr = ctl->stats->thresholds; thr; thr = thr->next, ++j )
 	{
 		// find the right index into our values
 		idx = ( thr->val * ct ) / thr->max;
-		bprintf( t, "%s.%s%s %f", d->base, thr->label, d->tags, t->wkspc[idx] );
+		bname( t, d, j, d->base, d->blen, thr->label, thr->llen, d->tags, d->tlen );
+		bput_dbl( t, t->wkspc[idx] );
 	}
 
+	// synthetics may read this path
+	if( d->synv )
+		synth_stats_publish( d, t->tval, (double) all, mean, upper, lower, t->wkspc[ct / 2] );
+
 	// are we doing std deviation and friends?
 	if( dhash_do_moments( d ) && ctl->stats->mom->min_pts <= ct )
 		stats_report_moments( t, d, ct, mean );
@@ -195,11 +392,11 @@ void stats_report_one( ST_THR *t, DHASH *d )
 	mem_free_points_list( list );
 
 	// keep count
-	t->points += ct;
+	t->points += all;
 
 	// and keep highest
-	if( ct > t->highest )
-		t->highest = ct;
+	if( all > t->highest )
+		t->highest = all;
 
 	// and keep track of active
 	++(t->active);
@@ -209,62 +406,112 @@ void stats_report_one( ST_THR *t, DHASH *d )
 #define st_thr_time( _name )		clock_gettime( CLOCK_REALTIME, &(t->_name) )
 
 
-void stats_stats_pass( ST_THR *t )
+// report a run of o's list - o may be us
+void stats_report_claimed( ST_THR *t, ST_THR *o, uint64_t from, uint64_t n )
 {
 	uint64_t i;
-	PTLIST *p;
 	DHASH *d;
 
+	for( i = from; i < ( from + n ); ++i )
+	{
+		d = o->dlist[i];
+
+		if( d->do_pass )
+		{
+			if( d->empty > 0 )
+				d->empty = 0;
+			d->seen = o->passes;
+
+			if( dhash_do_sketch( d ) )
+				stats_report_sketch( t, d );
+			else if( d->proc.points )
+				stats_report_one( t, d );
+
+			d->do_pass = 0;
+		}
+	}
+}
+
+
+void stats_stats_pass( ST_THR *t )
+{
+	DHASH *d, *n;
+	PTLIST *p;
+	SKETCH *s;
+	int64_t ct;
+
 	st_thr_time( steal );
 
-	// take the data
-	for( i = 0; i < t->conf->hsize; ++i )
-		if( ( i % t->max ) == t->id )
+	// take the data, from just the paths that have some
+	for( d = stats_thread_dirty( t ); d; d = n )
+	{
+		n = d->dnext;
+
+		data_dirty_clear( d );
+
+		if( !d->valid || !d->in.count )
+			continue;
+
+		if( dhash_do_sketch( d ) )
+		{
+			// just swap sketches - proc was reset after reporting
+			lock_stats( d );
+
+			s              = d->proc.sketch;
+			d->proc.sketch = d->in.sketch;
+			d->in.sketch   = s;
+			d->proc.count  = d->in.count;
+			d->in.count    = 0;
+			d->do_pass     = 1;
+
+			unlock_stats( d );
+		}
+		else
 		{
-			for( d = t->conf->data[i]; d && d->valid; d = d->next )
-				if( d->valid && d->in.count )
-				{
-					// prefetch a points object
-					// outside the lock
-					// this may fix some of the
-					// locking issues under high load
-					p = mem_new_points( );
-
-					lock_stats( d );
-
-					d->proc.points = d->in.points;
-					d->proc.count  = d->in.count;
-					d->in.points   = p;
-					d->in.count    = 0;
-					d->do_pass     = 1;
-
-					unlock_stats( d );
-				}
-				else if( d->empty >= 0 )
-					++(d->empty);
+			// prefetch a points object
+			// outside the lock
+			// this may fix some of the
+			// locking issues under high load
+			// and size it for as many as we had this time
+			// a capped path keeps no more than the cap
+			ct = d->in.count;
+			if( ctl->stats->max_pts && ct > ctl->stats->max_pts )
+				ct = ctl->stats->max_pts;
+
+			p = mem_new_points( mem_points_class( dhash_do_compact( d ) ? ( ct + 1 ) >> 1 : ct ) );
+
+			lock_stats( d );
+
+			d->proc.points = d->in.points;
+			d->proc.count  = d->in.count;
+			d->proc.res    = d->in.res;
+			d->in.points   = p;
+			d->in.count    = 0;
+			d->in.res      = NULL;
+			d->do_pass     = 1;
+
+			unlock_stats( d );
 		}
 
-	st_thr_time( stats );
+		stats_thread_keep( t, d );
+	}
 
-	// and report it
-	for( i = 0; i < t->conf->hsize; ++i )
-		if( ( i % t->max ) == t->id )
-			for( d = t->conf->data[i]; d && d->valid; d = d->next )
-				if( d->do_pass && d->proc.points )
-				{
-					if( d->empty > 0 )
-						d->empty = 0;
+	// the big ones are worth taking one at a time
+	stats_thread_publish( t, ctl->stats->qsort_thresh );
 
-					stats_report_one( t, d );
+	st_thr_time( stats );
 
-					d->do_pass = 0;
-				}
+	// and report it, sharing with any thread that's done early
+	stats_thread_share( t, &stats_report_claimed );
 
 	// keep track of all points
 	t->total += t->points;
 
 	// and work out how long that took
 	st_thr_time( done );
+
+	// and every so often, count the idle ones for gc
+	stats_thread_sweep( t );
 }
 
 
@@ -29,8 +29,12 @@ loop_call_fn stats_thread_pass;
 throw_fn stats_loop;
 
 
-#define STATS_HISTO_MAX			10
+#define STATS_HISTO_MAX			256
+#define STATS_HDR_MAX			4096
+#define STATS_HDR_MAX_BITS		10
+#define DEFAULT_HDR_BITS		4
 #define STATS_THRESH_MAX		20
+#define MIN_MAX_POINTS			1000
 
 
 enum stats_types
@@ -55,6 +59,18 @@ struct stat_predict_conf
 };
 
 
+struct stat_sketch_conf
+{
+	RGXL			*	rgx;
+	double				accuracy;	// relative error
+	double				lngamma;	// log of the bucket ratio
+	double				lgmul;		// 1 / lngamma
+	double				vmul;		// bucket key to value
+	int32_t				bins;		// max per sign
+	int8_t				enabled;
+};
+
+
 struct stat_thread_ctl
 {
 	ST_THR			*	next;
@@ -74,6 +90,7 @@ struct stat_thread_ctl
 	// output
 	BUF				*	prefix;
 	BUF				*	path;
+	DNAME			*	name;		// current line's cached name
 	BUF				**	ts;
 	IOBUF			**	bp;
 
@@ -86,11 +103,38 @@ struct stat_thread_ctl
 	int64_t				total;
 	int64_t				highest;
 	int64_t				predict;
+	int64_t				compact;
+	int64_t				cexact;		// compact, and nothing was rounded
+	int64_t				capped;
+
+	// the hash buckets we own
+	DHASH			***	buckets;
+	uint64_t			bcount;
+	uint64_t			bsize;
+	uint64_t			mcur;		// resize migration cursor
+	int					hgen;
+
+	// paths with data since the last pass
+	DHASH			*	dirty;		// pushed to by the updaters
+	DHASH			**	dlist;		// taken this pass, for reporting
+	uint64_t			dcount;
+	uint64_t			dsize;
+	uint32_t			passes;
+
+	// sharing the report phase out
+	uint64_t			dtake;		// next unclaimed in dlist
+	uint64_t			dheavy;		// big paths, at the front
+	int32_t				dready;		// dlist is open to others
+	int32_t				dbusy;		// others still working on it
+	int64_t				chunks;
+	int64_t				steals;
 
 	PMET			*	pm_pts;
 	PMET			*	pm_high;
 	PMET			*	pm_pct;
 	PMET			*	pm_tot;
+	PMET			*	pm_chunk;
+	PMET			*	pm_steal;
 
 	// timings
 	struct timespec		now;
@@ -124,8 +168,17 @@ struct stat_hist_conf
 
 	int32_t				matches;
 
-	int8_t				bcount;
-	int8_t				brange; // == count - 1
+	int32_t				bcount;
+	int32_t				brange; // == count - 1
+
+	// log-linear buckets
+	double				hlow;
+	double				hhigh;
+	uint64_t			hbase;
+	int32_t				hshift;
+	int32_t				hbits;
+
+	int8_t				hdr;
 	int8_t				enabled;
 	int8_t				is_default;
 };
@@ -141,6 +194,7 @@ struct stat_config
 	int					dtype;
 	int					threads;
 	int					enable;
+	int					combine;	// adder/gauge per-host combining
 	int64_t				period;		// msec config, converted to usec
 	int64_t				offset;		// msec config, converted to usec
 	stats_fn		*	statfn;
@@ -148,11 +202,26 @@ struct stat_config
 	// and the data
 	DHASH			**	data;
 	uint64_t			hsize;
+	uint64_t			hbase;		// starting size, fixes locks and thread ownership
 	int					dcurr;
 	LLCT				creates;
 	LLCT				gc_count;
+	uint64_t			gc_next;	// where gc's next slice starts
+
+	// online resizing
+	DHASH			**	odata;		// table being migrated out of
+	uint64_t			ohsize;
+	DHASH			**	retired;	// previous old table, freed after the next resize
+	DHIDX			*	index;		// open-addressed lookup index
+	DHIDX			*	iretired;	// previous index, freed after the next rebuild
+	double				hgrow;		// grow when dcurr/hsize passes this
+	int					hgen;		// odd while a resize is in progress
+	int					mdone;		// threads finished migrating
+	int64_t				resizes;
+	int					sweep;		// passes between counting empty paths
 
 	pthread_mutex_t		statslock;
+	pthread_mutex_t		hashlock;	// gc and starting a resize
 };
 
 
@@ -164,6 +233,8 @@ struct stats_metrics
 	PMETM			*	pts_count;
 	PMETM			*	pts_high;
 	PMETM			*	pct_time;
+	PMETM			*	chunks;
+	PMETM			*	steals;
 };
 
 
@@ -180,15 +251,23 @@ struct stats_control
 	ST_MOM			*	mom;
 	ST_MOM			*	mode;
 	ST_PRED			*	pred;
+	ST_SKCH			*	sketch;
+	ST_MOM			*	compact;
 
 	ST_HIST			*	histcf;
 	ST_HIST			*	histdefl;
 
 	ST_MET			*	metrics;
+	PSORT			*	psort;
 
 	// for new sorting
 	int32_t				qsort_thresh;
+	int32_t				psort_thresh;
+	int					psort_helpers;
+	int64_t				max_pts;	// per path, per interval, before sampling
 	int32_t				histcf_count;
+	int					select;		// select percentiles, rather than sort
+	int					simd;		// use vector maths if we can
 
 	char				tags_char;
 	int					tags_enabled;
@@ -204,6 +283,12 @@ tsf_fn stats_tsf_dotusec;
 tsf_fn stats_tsf_dotnsec;
 
 
+void bname_free( DHASH *d );
+
+// adder paths, for synthetics
+int stats_adder_fill( DHASH *d );
+void stats_adder_report( ST_THR *t, DHASH *d );
+
 void stats_start( void );
 void stats_init( void );
 void stats_stop( void );
@@ -87,6 +87,11 @@ void stats_set_bufs( ST_THR *t, ST_CFG *c, int64_t tval )
 		t->points  = 0;
 		t->highest = 0;
 		t->predict = 0;
+		t->compact = 0;
+		t->cexact  = 0;
+		t->capped  = 0;
+		t->chunks  = 0;
+		t->steals  = 0;
 	}
 
 	// just point to the prefix buffer we want
@@ -110,6 +115,232 @@ void stats_set_bufs( ST_THR *t, ST_CFG *c, int64_t tval )
 	}
 }
 
+// Work out which hash buckets are ours, across both tables while one
+// is being resized.  A bucket belongs to a thread by its index modulo
+// the starting size, so a path stays with the same thread as the table
+// grows.  The tables are steady under a table lock.
+static void stats_thread_buckets( ST_THR *t )
+{
+	ST_CFG *c = t->conf;
+	uint64_t i, n;
+
+	lock_table( 0 );
+
+	n = ( ( c->hsize + c->ohsize ) / c->hbase ) * ( ( c->hbase / t->max ) + 1 );
+
+	if( n > t->bsize )
+	{
+		if( t->buckets )
+			free( t->buckets );
+
+		t->buckets = (DHASH ***) allocz( n * sizeof( DHASH ** ) );
+		t->bsize   = n;
+	}
+
+	t->bcount = 0;
+
+	// old table first - those buckets empty as they move
+	if( c->odata )
+		for( i = 0; i < c->ohsize; ++i )
+			if( ( ( i % c->hbase ) % t->max ) == t->id )
+				t->buckets[t->bcount++] = c->odata + i;
+
+	for( i = 0; i < c->hsize; ++i )
+		if( ( ( i % c->hbase ) % t->max ) == t->id )
+			t->buckets[t->bcount++] = c->data + i;
+
+	unlock_table( 0 );
+}
+
+
+
+// called at the start of each pass, before touching the data
+void stats_thread_tables( ST_THR *t )
+{
+	ST_CFG *c = t->conf;
+	uint64_t n;
+	int g;
+
+	// the first thread decides when to grow
+	if( !t->id && c->hgrow > 0
+	 && !( c->hgen & 0x1 )
+	 && c->hsize < DATA_HASH_MAX_SIZE
+	 && stats_self_report_hash_ratio( c ) > c->hgrow )
+		data_hash_grow( c );
+
+	g = __atomic_load_n( &(c->hgen), __ATOMIC_ACQUIRE );
+
+	// first pass, or the tables have changed
+	if( !t->buckets || g != t->hgen )
+	{
+		t->hgen = g;
+		t->mcur = 0;
+		stats_thread_buckets( t );
+	}
+
+	// nothing to move?
+	if( !( g & 0x1 ) || t->mcur >= c->ohsize )
+		return;
+
+	for( n = 0; t->mcur < c->ohsize && n < DATA_HASH_MIGRATE; ++(t->mcur) )
+		if( ( ( t->mcur % c->hbase ) % t->max ) == t->id )
+		{
+			data_hash_migrate( c, t->mcur );
+			++n;
+		}
+
+	// last one out finishes off
+	if( t->mcur >= c->ohsize
+	 && __atomic_add_fetch( &(c->mdone), 1, __ATOMIC_ACQ_REL ) == t->max )
+		data_hash_grow_done( c );
+}
+
+
+
+// Take the paths that have had data since the last pass.  Each one
+// needs data_dirty_clear() before its steal, or else putting back
+// with data_dirty_push() if it should be looked at next pass anyway.
+DHASH *stats_thread_dirty( ST_THR *t )
+{
+	// close last pass's list, and wait for anyone still helping with it
+	__atomic_store_n( &(t->dready), 0, __ATOMIC_SEQ_CST );
+
+	while( __atomic_load_n( &(t->dbusy), __ATOMIC_SEQ_CST ) )
+		microsleep( 50 );
+
+	t->dcount = 0;
+	t->dtake  = 0;
+	t->dheavy = 0;
+
+	return __atomic_exchange_n( &(t->dirty), NULL, __ATOMIC_ACQUIRE );
+}
+
+
+// hold on to a stolen path for the report phase - once it is
+// clear it can go back on the dirty list, so we can't use dnext
+void stats_thread_keep( ST_THR *t, DHASH *d )
+{
+	DHASH **l;
+	uint64_t sz;
+
+	if( t->dcount == t->dsize )
+	{
+		sz = ( t->dsize ) ? 2 * t->dsize : 1024;
+		l  = (DHASH **) allocz( sz * sizeof( DHASH * ) );
+
+		if( t->dlist )
+		{
+			memcpy( l, t->dlist, t->dcount * sizeof( DHASH * ) );
+			free( t->dlist );
+		}
+
+		t->dlist = l;
+		t->dsize = sz;
+	}
+
+	t->dlist[t->dcount++] = d;
+}
+
+
+// Open the stolen list to the other threads of our type.  Paths with
+// at least heavy points go to the front, to be claimed one at a time.
+void stats_thread_publish( ST_THR *t, int64_t heavy )
+{
+	uint64_t i;
+	DHASH *d;
+
+	if( heavy > 0 )
+		for( i = 0; i < t->dcount; ++i )
+			if( t->dlist[i]->proc.count >= heavy )
+			{
+				d = t->dlist[i];
+				t->dlist[i] = t->dlist[t->dheavy];
+				t->dlist[t->dheavy++] = d;
+			}
+
+	__atomic_store_n( &(t->dready), 1, __ATOMIC_SEQ_CST );
+}
+
+
+// claim the next run from o's list - returns how many
+static inline uint64_t stats_thread_claim( ST_THR *o, uint64_t *from )
+{
+	uint64_t i, n;
+
+	i = __atomic_load_n( &(o->dtake), __ATOMIC_RELAXED );
+	n = ( i < o->dheavy ) ? 1 : STATS_CLAIM_CHUNK;
+	i = __atomic_fetch_add( &(o->dtake), n, __ATOMIC_ACQ_REL );
+
+	if( i >= o->dcount )
+		return 0;
+
+	if( ( i + n ) > o->dcount )
+		n = o->dcount - i;
+
+	*from = i;
+	return n;
+}
+
+
+// Report our own list, then help with anyone else's that is still
+// going.  Whoever claims a run reports it into their own buffers.
+void stats_thread_share( ST_THR *t, claim_fn *fp )
+{
+	uint64_t from, n;
+	ST_THR *o;
+	int i;
+
+	while( ( n = stats_thread_claim( t, &from ) ) )
+	{
+		(*fp)( t, t, from, n );
+		++(t->chunks);
+	}
+
+	for( i = 1; i < t->max; ++i )
+	{
+		o = t->conf->ctls + ( ( t->id + i ) % t->max );
+
+		// mark ourselves before looking, so they can't reset under us
+		__atomic_add_fetch( &(o->dbusy), 1, __ATOMIC_SEQ_CST );
+
+		if( __atomic_load_n( &(o->dready), __ATOMIC_SEQ_CST ) )
+			while( ( n = stats_thread_claim( o, &from ) ) )
+			{
+				(*fp)( t, o, from, n );
+				++(t->chunks);
+				++(t->steals);
+			}
+
+		__atomic_sub_fetch( &(o->dbusy), 1, __ATOMIC_SEQ_CST );
+	}
+}
+
+
+// Idle paths are never looked at by the passes, so gc's empty counts
+// are worked out every so often from the last pass that had data.
+// Nothing else needs them, so without gc we don't bother.
+void stats_thread_sweep( ST_THR *t )
+{
+	uint64_t i;
+	DHASH *d;
+
+	if( !ctl->gc->enabled || ( t->passes % t->conf->sweep ) )
+		return;
+
+	for( i = 0; i < t->bcount; ++i )
+		for( d = *(t->buckets[i]); d; d = d->next )
+			if( d->valid && d->empty >= 0 )
+			{
+				// not reported yet, so count from now
+				if( !d->seen )
+					d->seen = t->passes;
+
+				d->empty = (int32_t) ( t->passes - d->seen );
+			}
+}
+
+
+
 // set a prefix, make sure of a trailing .
 // return a copy of a prefix with a trailing .
 void stats_prefix( ST_CFG *c, char *s )
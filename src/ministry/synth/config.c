@@ -55,9 +55,17 @@ struct synth_fn_def synth_fn_defs[] =
 };
 
 
-int synth_config_path( SYNTH *s, AVP *av )
+// the stats values a synthetic can read, by suffix
+static const char *synth_stat_names[SYNTH_STAT_MAX] =
 {
-	char *p;
+	"count", "mean", "upper", "lower", "median"
+};
+
+
+int synth_config_path( SYNTH *s, AVP *av, int type )
+{
+	char *p, *dot;
+	int f = 0;
 
 	if( s->target_path )
 		p = s->target_path;
@@ -70,8 +78,33 @@ int synth_config_path( SYNTH *s, AVP *av )
 		return -1;
 	}
 
-	s->paths[s->parts] = av_copy( av );
-	s->plens[s->parts] = av->vlen;
+	// stats sources say which value they want, as the stats path would
+	if( type == SYNTH_SRC_STATS )
+	{
+		if( !( dot = memrchr( av->vptr, '.', av->vlen ) ) )
+		{
+			err( "Synthetic %s stats source %s has no value suffix.", p, av->vptr );
+			return -1;
+		}
+
+		for( f = 0; f < SYNTH_STAT_MAX; ++f )
+			if( !strcasecmp( dot + 1, synth_stat_names[f] ) )
+				break;
+
+		if( f == SYNTH_STAT_MAX )
+		{
+			err( "Synthetic %s stats source %s must end in count, mean, upper, lower or median.", p, av->vptr );
+			return -1;
+		}
+
+		av->vlen = dot - av->vptr;
+		*dot = '\0';
+	}
+
+	s->paths[s->parts]  = av_copy( av );
+	s->plens[s->parts]  = av->vlen;
+	s->stype[s->parts]  = type;
+	s->sfield[s->parts] = f;
 
 	++(s->parts);
 
@@ -106,7 +139,21 @@ int synth_config_line( AVP *av )
 	}
 	else if( attIs( "source" ) )
 	{
-		if( synth_config_path( s, av ) != 0 )
+		if( synth_config_path( s, av, SYNTH_SRC_ADDER ) != 0 )
+			return -1;
+
+		__synth_cfg_state = 1;
+	}
+	else if( attIs( "gaugeSource" ) )
+	{
+		if( synth_config_path( s, av, SYNTH_SRC_GAUGE ) != 0 )
+			return -1;
+
+		__synth_cfg_state = 1;
+	}
+	else if( attIs( "statsSource" ) )
+	{
+		if( synth_config_path( s, av, SYNTH_SRC_STATS ) != 0 )
 			return -1;
 
 		__synth_cfg_state = 1;
@@ -39,6 +39,14 @@ struct synth_fn_def
 };
 
 
+enum synth_source_types
+{
+	SYNTH_SRC_ADDER = 0,
+	SYNTH_SRC_GAUGE,
+	SYNTH_SRC_STATS
+};
+
+
 struct synth_data
 {
 	SYNTH			*	next;
@@ -46,6 +54,14 @@ struct synth_data
 	DHASH			*	dhash[SYNTH_PART_MAX];
 	char			*	paths[SYNTH_PART_MAX];
 	int					plens[SYNTH_PART_MAX];
+	SYNTH			*	parent[SYNTH_PART_MAX];	// source is another synth's target
+	int8_t				stype[SYNTH_PART_MAX];
+	int8_t				sfield[SYNTH_PART_MAX];	// stats sources only
+	int16_t				owner[SYNTH_PART_MAX];	// adder thread that steals it
+
+	// this interval's source values
+	double				vals[SYNTH_PART_MAX];
+	int64_t				cnts[SYNTH_PART_MAX];
 
 	DHASH			*	target;
 	char			*	target_path;
@@ -60,6 +76,24 @@ struct synth_data
 	int					max_absent;
 
 	SYNDEF			*	def;
+
+	// synths that read our target
+	SYNTH			**	users;
+	int					ucount;
+	int					sparents;
+
+	// gathering for an interval
+	pthread_mutex_t		lock;
+	int64_t			*	tarr;			// per adder thread; -1 if not needed
+	int64_t				tval;			// the interval we are gathering
+	int					nthr;
+	int					arrived;
+	int					pdone;
+	int					done;
+
+	// what we made, for synths that read us
+	double				result;
+	int64_t				rcount;
 };
 
 
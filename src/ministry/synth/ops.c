@@ -27,9 +27,9 @@ static inline int __synth_set_first( SYNTH *s )
 	int i;
 
 	for( i = 0; i < s->parts; ++i )
-		if( s->dhash[i]->proc.count > 0 )
+		if( s->cnts[i] > 0 )
 		{
-			s->target->proc.total = s->dhash[i]->proc.total;
+			s->target->proc.total = s->vals[i];
 			break;
 		}
 
@@ -44,27 +44,22 @@ void synth_sum( SYNTH *s )
 	s->target->proc.total = 0;
 
 	for( i = 0; i < s->parts; ++i )
-		s->target->proc.total += s->dhash[i]->proc.total;
+		s->target->proc.total += s->vals[i];
 
 	s->target->proc.total *= s->factor;
 }
 
 void synth_diff( SYNTH *s )
 {
-	s->target->proc.total = s->factor * ( s->dhash[0]->proc.total - s->dhash[1]->proc.total );
+	s->target->proc.total = s->factor * ( s->vals[0] - s->vals[1] );
 }
 
 void synth_div( SYNTH *s )
 {
-	DHASH *a, *b;
-
-	a = s->dhash[0];
-	b = s->dhash[1];
-
-	if( b->proc.total == 0 )
+	if( s->vals[1] == 0 )
 		s->target->proc.total = 0;
 	else
-		s->target->proc.total = ( a->proc.total * s->factor ) / b->proc.total;
+		s->target->proc.total = ( s->vals[0] * s->factor ) / s->vals[1];
 }
 
 void synth_prod( SYNTH *s )
@@ -75,18 +70,13 @@ void synth_prod( SYNTH *s )
 
 	// only use present values
 	for( i = 0; i < s->parts; ++i )
-		if( s->dhash[i]->proc.count > 0 )
-			s->target->proc.total *= s->dhash[i]->proc.total;
+		if( s->cnts[i] > 0 )
+			s->target->proc.total *= s->vals[i];
 }
 
 void synth_cap( SYNTH *s )
 {
-	DHASH *a, *b;
-
-	a = s->dhash[0];
-	b = s->dhash[1];
-
-	s->target->proc.total = ( a->proc.total < b->proc.total ) ? a->proc.total : b->proc.total;
+	s->target->proc.total = ( s->vals[0] < s->vals[1] ) ? s->vals[0] : s->vals[1];
 }
 
 void synth_max( SYNTH *s )
@@ -96,8 +86,8 @@ void synth_max( SYNTH *s )
 	i = __synth_set_first( s );
 
 	for( ; i < s->parts; ++i )
-		if( s->target->proc.total < s->dhash[i]->proc.total )
-			s->target->proc.total = s->dhash[i]->proc.total;
+		if( s->target->proc.total < s->vals[i] )
+			s->target->proc.total = s->vals[i];
 
 	s->target->proc.total *= s->factor;
 }
@@ -109,8 +99,8 @@ void synth_min( SYNTH *s )
 	i = __synth_set_first( s );
 
 	for( ; i < s->parts; ++i )
-		if( s->target->proc.total > s->dhash[i]->proc.total )
-			s->target->proc.total = s->dhash[i]->proc.total;
+		if( s->target->proc.total > s->vals[i] )
+			s->target->proc.total = s->vals[i];
 
 	s->target->proc.total *= s->factor;
 }
@@ -126,10 +116,10 @@ void synth_spread( SYNTH *s )
 
 	for( ; i < s->parts; ++i )
 	{
-		if( max < s->dhash[i]->proc.total )
-			max = s->dhash[i]->proc.total;
-		if( min > s->dhash[i]->proc.total )
-			min = s->dhash[i]->proc.total;
+		if( max < s->vals[i] )
+			max = s->vals[i];
+		if( min > s->vals[i] )
+			min = s->vals[i];
 	}
 
 	s->target->proc.total = s->factor * ( max - min );
@@ -22,95 +22,316 @@
 #include "local.h"
 
 
+/*
+ *  Synthetics used to hold every adder thread at a barrier until all
+ *  of them had stolen their paths, and then one thread worked out all
+ *  of them in config order.  Now each synthetic gathers for itself.
+ *
+ *  Each adder thread, once it has stolen its paths, takes the values of
+ *  the sources it owns into the synthetics that read them.  Whichever
+ *  thread is the last in for a synthetic works it out there and then,
+ *  and reports it, and that counts as a source arriving for each of
+ *  the synthetics that read it in turn.  So they come out in dependency
+ *  order, spread over the adder threads, and nobody waits for anyone.
+ *
+ *  Gauge sources are read as they stand.  Stats sources are read from
+ *  what the stats threads last reported, if that's recent enough.  The
+ *  synth thread just goes looking for sources that don't exist yet.
+ */
+
+
+
+static inline int synth_owner( DHASH *d )
+{
+	ST_CFG *c = ctl->stats->adder;
+
+	return (int) ( ( d->sum % c->hbase ) % c->threads );
+}
 
-void synth_generate( SYNTH *s )
+
+// say we need an adder thread to check in - call with the lock held
+static inline void synth_need( SYNTH *s, int thr )
 {
-	uint64_t pt, ct;
+	if( s->tarr[thr] < 0 )
+	{
+		s->tarr[thr] = 0;
+		++(s->nthr);
+	}
+}
+
+
+static void synth_find( SYNTH *s )
+{
+	static const int dtypes[3] = { DATA_TYPE_ADDER, DATA_TYPE_GAUGE, DATA_TYPE_STATS };
+	DHASH *d;
 	int i;
 
-	// check everything it needs exists...
-	if( s->missing > 0 )
+	for( i = 0; i < s->parts; ++i )
 	{
-		// some missing - go looking
-		for( i = 0; i < s->parts; ++i )
-		{
-			if( s->dhash[i] )
-				continue;
+		if( s->dhash[i] )
+			continue;
 
-			// did we fetch a thing?
-			if( ( s->dhash[i] = data_locate( s->paths[i], s->plens[i], DATA_TYPE_ADDER ) ) != NULL )
-			{
-				// exempt that from gc
-				s->dhash[i]->empty = -1;
-				s->missing--;
-				debug( "Found source %s for synth %s", s->dhash[i]->path, s->target_path );
-			}
+		if( !( d = data_locate( s->paths[i], s->plens[i], dtypes[s->stype[i]] ) ) )
+			continue;
+
+		// exempt that from gc
+		d->empty = -1;
+
+		// and have the stats thread tell us about it
+		if( s->stype[i] == SYNTH_SRC_STATS && !d->synv )
+		{
+			lock_stats( d );
+			if( !d->synv )
+				d->synv = (SYNVAL *) allocz( sizeof( SYNVAL ) );
+			unlock_stats( d );
 		}
 
-		// weirdness check
-		if( s->missing < 0 )
+		pthread_mutex_lock( &(s->lock) );
+
+		s->dhash[i] = d;
+		s->missing--;
+
+		if( s->stype[i] == SYNTH_SRC_ADDER )
 		{
-			warn( "Synthetic %s has missing count %d", s->target_path, s->missing );
-			s->missing = 0;
+			s->owner[i] = synth_owner( d );
+			synth_need( s, s->owner[i] );
 		}
+
+		pthread_mutex_unlock( &(s->lock) );
+
+		debug( "Found source %s for synth %s", d->path, s->target_path );
 	}
+}
+
+
+void synth_pass( int64_t tval, void *arg )
+{
+	SYNTH *s;
+
+	for( s = _syn->list; s; s = s->next )
+		if( s->missing > 0 )
+			synth_find( s );
+}
 
-	// are we a go?
-	if( s->missing == 0 )
+
+
+// the rest of the sources, once we have the adder ones
+static void synth_gather( SYNTH *s )
+{
+	int64_t window;
+	SYNVAL *v;
+	DHASH *d;
+	int i;
+
+	// stats values are good for one stats interval, and a bit
+	window = 1000 * ( ctl->stats->stats->period + ctl->stats->adder->period );
+
+	for( i = 0; i < s->parts; ++i )
 	{
-		s->absent = 0;
+		d = s->dhash[i];
 
-		// check to see if there's any data
-		for( pt = 0, i = 0; i < s->parts; ++i )
+		if( s->parent[i] )
 		{
-			if( ( ct = s->dhash[i]->proc.count ) == 0 )
-				++(s->absent);
-			else
-				pt += ct;
+			s->vals[i] = s->parent[i]->result;
+			s->cnts[i] = s->parent[i]->rcount;
 		}
+		else if( s->stype[i] == SYNTH_SRC_GAUGE )
+		{
+			lock_gauge( d );
+			s->vals[i] = d->in.total;
+			unlock_gauge( d );
 
-		// make the point appropriately
-		s->target->proc.count = pt;
-
-		// make sure not too many are missing
-		if( pt > 0 && s->absent <= s->max_absent )
+			s->cnts[i] = 1;
+		}
+		else if( s->stype[i] == SYNTH_SRC_STATS )
 		{
-			// only generate if there's anything to do
-			(s->def->fn)( s );
+			lock_stats( d );
 
-			// and mark it for reporting
-			s->target->do_pass = 1;
+			v = d->synv;
+
+			if( v->tval && ( s->tval - v->tval ) < window )
+			{
+				s->vals[i] = v->vals[s->sfield[i]];
+				s->cnts[i] = (int64_t) v->vals[SYNTH_STAT_COUNT];
+			}
+			else
+			{
+				s->vals[i] = 0;
+				s->cnts[i] = 0;
+			}
+
+			unlock_stats( d );
 		}
 	}
 }
 
 
-void synth_pass( int64_t tval, void *arg )
+// returns 1 if we made a value - call with the lock held
+static int synth_generate( SYNTH *s )
 {
-	SYNTH *s;
+	uint64_t pt;
+	int i;
+
+	s->rcount = 0;
+
+	// we can't do anything until everything exists
+	if( s->missing > 0 )
+		return 0;
+
+	synth_gather( s );
+
+	s->absent = 0;
+
+	// check to see if there's any data
+	for( pt = 0, i = 0; i < s->parts; ++i )
+	{
+		if( s->cnts[i] <= 0 )
+			++(s->absent);
+		else
+			pt += s->cnts[i];
+	}
+
+	// make sure not too many are missing
+	if( pt == 0 || s->absent > s->max_absent )
+		return 0;
+
+	// only generate if there's anything to do
+	(s->def->fn)( s );
+
+	// make the point appropriately
+	s->target->proc.count = pt;
+	s->target->do_pass    = 1;
+
+	// and keep it for anyone reading us
+	s->result = s->target->proc.total;
+	s->rcount = pt;
+
+	return 1;
+}
+
+
+static void synth_parent_done( ST_THR *t, SYNTH *s, int64_t tval );
+
+
+// new interval, or an old one?  call with the lock held
+static inline int synth_interval( SYNTH *s, int64_t tval )
+{
+	if( tval < s->tval )
+		return -1;
+
+	if( tval > s->tval )
+	{
+		s->tval    = tval;
+		s->arrived = 0;
+		s->pdone   = 0;
+		s->done    = 0;
+	}
+
+	return 0;
+}
+
+
+// work it out if everything is in - unlocks it either way
+static void synth_try( ST_THR *t, SYNTH *s )
+{
+	int64_t tval;
+	int i, gen;
+
+	if( s->done
+	 || s->arrived < s->nthr
+	 || s->pdone < s->sparents )
+	{
+		pthread_mutex_unlock( &(s->lock) );
+		return;
+	}
+
+	s->done = 1;
+	tval    = s->tval;
+	gen     = synth_generate( s );
 
-	lock_synth( );
+	pthread_mutex_unlock( &(s->lock) );
 
-	while( _syn->tready < _syn->tcount )
+	// it goes out with our own
+	if( gen )
+		stats_adder_report( t, s->target );
+
+	// and anything reading it gets a go
+	for( i = 0; i < s->ucount; ++i )
+		synth_parent_done( t, s->users[i], tval );
+}
+
+
+static void synth_parent_done( ST_THR *t, SYNTH *s, int64_t tval )
+{
+	pthread_mutex_lock( &(s->lock) );
+
+	if( synth_interval( s, tval ) )
 	{
-		pthread_cond_wait( &(_syn->threads_ready), &(ctl->locks->synth) );
+		pthread_mutex_unlock( &(s->lock) );
+		return;
 	}
 
-	// we are a go
+	++(s->pdone);
+
+	synth_try( t, s );
+}
 
-	_syn->tready = 0;
-	//debug( "Generating synthetics." );
+
+void synth_arrive( ST_THR *t )
+{
+	SYNTH *s;
+	DHASH *d;
+	int i;
 
 	for( s = _syn->list; s; s = s->next )
-		synth_generate( s );
+	{
+		// quick look before locking
+		if( s->tarr[t->id] < 0 )
+			continue;
+
+		pthread_mutex_lock( &(s->lock) );
+
+		if( synth_interval( s, t->tval )
+		 || s->tarr[t->id] == t->tval )
+		{
+			pthread_mutex_unlock( &(s->lock) );
+			continue;
+		}
+
+		s->tarr[t->id] = t->tval;
+		++(s->arrived);
+
+		// take the values of the sources we own
+		// they are only stolen by us, so this is safe
+		for( i = 0; i < s->parts; ++i )
+			if( s->stype[i] == SYNTH_SRC_ADDER
+			 && !s->parent[i]
+			 && ( d = s->dhash[i] )
+			 && s->owner[i] == (int) t->id )
+			{
+				s->vals[i] = d->proc.total;
+				s->cnts[i] = d->proc.count;
+			}
+
+		synth_try( t, s );
+	}
+}
+
 
-	// tell everyone to proceed
-	_syn->tproceed = _syn->tcount;
+void synth_stats_publish( DHASH *d, int64_t tval, double count, double mean, double upper, double lower, double median )
+{
+	SYNVAL *v = d->synv;
 
-	pthread_cond_broadcast( &(_syn->threads_done) );
+	lock_stats( d );
 
-	// and release them
-	unlock_synth( );
+	v->vals[SYNTH_STAT_COUNT]  = count;
+	v->vals[SYNTH_STAT_MEAN]   = mean;
+	v->vals[SYNTH_STAT_UPPER]  = upper;
+	v->vals[SYNTH_STAT_LOWER]  = lower;
+	v->vals[SYNTH_STAT_MEDIAN] = median;
+	v->tval = tval;
+
+	unlock_stats( d );
 }
 
 
@@ -118,28 +339,109 @@ void synth_pass( int64_t tval, void *arg )
 
 void synth_loop( THRD *t )
 {
-	// locking
-	_syn->tcount = ctl->stats->adder->threads;
-	pthread_cond_init( &(_syn->threads_ready), NULL );
-	pthread_cond_init( &(_syn->threads_done),  NULL );
-
-	// and loop
+	// just looks for sources we don't have yet
 	loop_control( "synthetics", synth_pass, NULL, ctl->stats->adder->period, LOOP_SYNC, ctl->stats->adder->offset );
-
-	pthread_cond_destroy( &(_syn->threads_ready) );
-	pthread_cond_destroy( &(_syn->threads_done)  );
 }
 
 
 
+// Link up synths that read each other's targets, and put them in an
+// order where each comes after everything it reads.  Anything left
+// over is in a loop, and can never be worked out.
+static void synth_order( void )
+{
+	SYNTH *s, *u, **q, *list, *end;
+	int i, j, qh, qt;
+
+	if( !_syn->scount )
+		return;
+
+	q = (SYNTH **) allocz( _syn->scount * sizeof( SYNTH * ) );
+
+	for( s = _syn->list; s; s = s->next )
+		for( i = 0; i < s->parts; ++i )
+		{
+			if( s->stype[i] != SYNTH_SRC_ADDER )
+				continue;
+
+			for( u = _syn->list; u; u = u->next )
+				if( s->plens[i] == (int) strlen( u->target_path )
+				 && !memcmp( s->paths[i], u->target_path, s->plens[i] ) )
+					break;
+
+			if( !u )
+				continue;
+
+			s->parent[i] = u;
+			++(s->sparents);
+			++(u->ucount);
+		}
+
+	for( s = _syn->list; s; s = s->next )
+		if( s->ucount )
+		{
+			s->users  = (SYNTH **) allocz( s->ucount * sizeof( SYNTH * ) );
+			s->ucount = 0;
+		}
+
+	for( s = _syn->list; s; s = s->next )
+		for( i = 0; i < s->parts; ++i )
+			if( ( u = s->parent[i] ) )
+				u->users[u->ucount++] = s;
+
+	// count down what each is waiting for - pdone
+	// isn't used for anything else until we start
+	for( qt = 0, s = _syn->list; s; s = s->next )
+	{
+		s->pdone = s->sparents;
+		if( !s->pdone )
+			q[qt++] = s;
+	}
+
+	for( qh = 0; qh < qt; ++qh )
+		for( j = 0; j < q[qh]->ucount; ++j )
+		{
+			u = q[qh]->users[j];
+			if( --(u->pdone) == 0 )
+				q[qt++] = u;
+		}
+
+	for( s = _syn->list; s; s = s->next )
+		if( s->pdone > 0 )
+		{
+			err( "Synthetic %s reads itself, through its sources - it will not be generated.", s->target_path );
+			s->pdone = 0;
+		}
+
+	// rebuild the list in that order, without the loops
+	for( list = end = NULL, i = 0; i < qt; ++i )
+	{
+		q[i]->next = NULL;
+
+		if( end )
+			end->next = q[i];
+		else
+			list = q[i];
+
+		end = q[i];
+	}
+
+	_syn->list   = list;
+	_syn->scount = qt;
+
+	free( q );
+}
+
+
 
 void synth_init( void )
 {
+	int i, l, threads;
 	SYNTH *s;
-	int l;
+
+	threads = ctl->stats->adder->threads;
 
 	// reverse the list to preserve the order in config
-	// this means synths can reference each other!
 	_syn->list = (SYNTH *) mem_reverse_list( _syn->list );
 
 	// then light them up
@@ -153,11 +455,19 @@ void synth_init( void )
 		// find that dhash
 		s->target = data_locate( s->target_path, l, DATA_TYPE_ADDER );
 
-		// exempt it from gc
-		s->target->empty = -1;
+		// exempt it from gc, and from its own thread
+		s->target->empty   = -1;
+		s->target->checks |= DHASH_CHECK_SYNTH;
 
-		// mark us as not having everything yet
-		s->missing = s->parts;
+		pthread_mutex_init( &(s->lock), NULL );
+
+		// the target's own thread always checks in, so
+		// we are worked out even with no adder sources
+		s->tarr = (int64_t *) allocz( threads * sizeof( int64_t ) );
+		for( i = 0; i < threads; ++i )
+			s->tarr[i] = -1;
+
+		synth_need( s, synth_owner( s->target ) );
 
 		// and set the max absent; -ve values are parts - val
 		if( s->max_absent < 0 )
@@ -167,9 +477,22 @@ void synth_init( void )
 			else
 				s->max_absent = s->parts + s->def->max_absent;
 		}
+	}
+
+	// synths can reference each other, in any order
+	synth_order( );
+
+	for( s = _syn->list; s; s = s->next )
+	{
+		// other synths we have already
+		for( i = 0; i < s->parts; ++i )
+			if( s->parent[i] )
+				s->dhash[i] = s->parent[i]->target;
+
+		// mark us as not having everything yet
+		s->missing = s->parts - s->sparents;
 
 		info( "Synthetic '%s' created.", s->target_path );
 	}
 }
 
-
@@ -23,18 +23,32 @@
 #define MINISTRY_SYNTH_H
 
 
+// values of a stats path that synthetics can use
+enum synth_stat_fields
+{
+	SYNTH_STAT_COUNT = 0,
+	SYNTH_STAT_MEAN,
+	SYNTH_STAT_UPPER,
+	SYNTH_STAT_LOWER,
+	SYNTH_STAT_MEDIAN,
+	SYNTH_STAT_MAX
+};
+
+
+// hung off a stats path that a synthetic reads,
+// set by the stats thread each time it reports it
+struct synth_value
+{
+	double				vals[SYNTH_STAT_MAX];
+	int64_t				tval;		// the interval they are from
+};
+
+
 struct synth_control
 {
-	SYNTH			*	list;
+	SYNTH			*	list;		// in dependency order
 	int					scount;
 	int					wait_usec;
-
-	int					tcount;
-	int					tready;
-	int					tproceed;
-
-	pthread_cond_t		threads_ready;
-	pthread_cond_t      threads_done;
 };
 
 
@@ -45,6 +59,12 @@ throw_fn synth_loop;
 
 void synth_init( void );
 
+// called by each adder thread once it has stolen its paths
+void synth_arrive( ST_THR *t );
+
+// called by the stats threads for paths synthetics read
+void synth_stats_publish( DHASH *d, int64_t tval, double count, double mean, double upper, double lower, double median );
+
 SYN_CTL *synth_config_defaults( void );
 conf_line_fn synth_config_line;
 
@@ -34,28 +34,35 @@ TTYPE targets_type_defns[TGTS_TYPE_MAX] =
 		.name  = "unknown",
 		.port  = 0,
 		.tsfp  = NULL,
-		.wrfp  = NULL
+		.wrfp  = NULL,
+		.lnfp  = NULL
 	},
 	{
 		.type  = TGTS_TYPE_GRAPHITE,
 		.name  = "graphite",
 		.port  = 2003,
 		.tsfp  = &stats_tsf_sec,
-		.wrfp  = &targets_write_graphite
+		.wrfp  = &targets_write_graphite,
+		.lnfp  = &targets_line_graphite,
+		.prec  = DEFAULT_TARGET_PRECISION
 	},
 	{
 		.type  = TGTS_TYPE_ARCHIVIST,
 		.name  = "archivist",
 		.port  = 3801,
 		.tsfp  = &stats_tsf_usec,
-		.wrfp  = &targets_write_graphite
+		.wrfp  = &targets_write_graphite,
+		.lnfp  = &targets_line_graphite,
+		.prec  = DEFAULT_TARGET_PRECISION
 	},
 	{
 		.type  = TGTS_TYPE_OPENTSDB,
 		.name  = "opentsdb",
 		.port  = 0,
 		.tsfp  = &stats_tsf_msec,
-		.wrfp  = &targets_write_opentsdb
+		.wrfp  = &targets_write_opentsdb,
+		.lnfp  = &targets_line_opentsdb,
+		.prec  = DEFAULT_TARGET_PRECISION
 	}
 };
 
@@ -118,6 +125,32 @@ void targets_write_opentsdb( ST_THR *t, BUF *ts, IOBUF *b )
 
 
 
+// the same again, from a cached name and a rendered value
+void targets_line_graphite( IOBUF *b, char *name, int nlen, char *val, int vlen, BUF *ts )
+{
+	buf_appends( b->bf, name, nlen );
+	buf_addchar( b->bf, ' ' );
+	buf_appends( b->bf, val, vlen );
+	buf_append( b->bf, ts );
+}
+
+
+void targets_line_opentsdb( IOBUF *b, char *name, int nlen, char *val, int vlen, BUF *ts )
+{
+	buf_appends( b->bf, "put ", 4 );
+	buf_appends( b->bf, name, nlen );
+
+	// timestamp, but without the newline
+	buf_append( b->bf, ts );
+	strbuf_chop( b->bf );
+
+	buf_addchar( b->bf, ' ' );
+	buf_appends( b->bf, val, vlen );
+	buf_appends( b->bf, " source=ministry\n", 17 );
+}
+
+
+
 void targets_start( void )
 {
 	TSET *s;
@@ -210,6 +243,25 @@ int targets_set_type( TGT *t, char *type, int len )
 
 
 
+int targets_set_precision( char *type, int prec )
+{
+	TTYPE *tt = targets_type_defns;
+	int i;
+
+	// skip unknown
+	for( ++tt, i = 1; i < TGTS_TYPE_MAX; ++i, ++tt )
+		if( !strcasecmp( tt->name, type ) )
+		{
+			tt->prec = prec;
+			return 0;
+		}
+
+	err( "Unrecognised target type for precision: %s", type );
+	return -1;
+}
+
+
+
 TGTS_CTL *targets_config_defaults( void )
 {
 	TGTS_CTL *t = (TGTS_CTL *) mem_perm( sizeof( TGTS_CTL ) );
@@ -22,6 +22,10 @@
 #ifndef MINISTRY_TARGETS_H
 #define MINISTRY_TARGETS_H
 
+#define DEFAULT_TARGET_PRECISION		6
+#define TARGETS_LINE_EXTRA				24		// most a line fn adds
+
+
 // backend types
 enum targets_backends
 {
@@ -39,7 +43,9 @@ struct targets_type_data
 	char				*	name;
 	tsf_fn				*	tsfp;
 	targets_fn			*	wrfp;
+	tgt_line_fn			*	lnfp;
 	uint16_t				port;
+	int						prec;	// decimal places, or -1 for shortest
 };
 
 
@@ -76,7 +82,11 @@ struct targets_control
 targets_fn targets_write_graphite;
 targets_fn targets_write_opentsdb;
 
+tgt_line_fn targets_line_graphite;
+tgt_line_fn targets_line_opentsdb;
+
 target_cfg_fn targets_set_type;
+int targets_set_precision( char *type, int prec );
 
 void targets_start( void );
 int targets_init( void );
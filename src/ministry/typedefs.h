@@ -40,21 +40,31 @@ typedef struct stat_threshold		ST_THOLD;
 typedef struct stat_hist_conf       ST_HIST;
 typedef struct stat_moments			ST_MOM;
 typedef struct stat_predict_conf	ST_PRED;
+typedef struct stat_sketch_conf		ST_SKCH;
 typedef struct stats_metrics        ST_MET;
 typedef struct maths_prediction		PRED;
 typedef struct maths_moments		MOMS;
+typedef struct maths_sketch			SKETCH;
+typedef struct maths_sketch_store	SKSTORE;
+typedef struct maths_psort			PSORT;
 typedef struct history_data_point	DPT;
 typedef struct history				HIST;
 typedef struct points_list			PTLIST;
 typedef struct data_hash_vals		DVAL;
 typedef struct data_hash_entry		DHASH;
+typedef struct data_hash_index		DHIDX;
+typedef struct data_name			DNAME;
 typedef struct data_histogram       DHIST;
+typedef struct data_reservoir		DRES;
 typedef struct data_type_params		DTYPE;
+typedef struct data_combine			DCMB;
+typedef struct data_combine_entry	DCENT;
 typedef struct targets_type_data	TTYPE;
 typedef struct targets_set			TSET;
 typedef struct host_prefixes		HPRFXS;
 typedef struct synth_data			SYNTH;
 typedef struct synth_fn_def			SYNDEF;
+typedef struct synth_value			SYNVAL;
 typedef struct fetch_target			FETCH;
 typedef struct metrics_entry		METRY;
 typedef struct metrics_data			MDATA;
@@ -64,6 +74,8 @@ typedef struct metrics_data			MDATA;
 typedef void targets_fn ( ST_THR *, BUF *, IOBUF * );
 typedef void tsf_fn ( ST_THR *, BUF * );
 typedef void stats_fn ( ST_THR * );
+typedef void claim_fn ( ST_THR *, ST_THR *, uint64_t, uint64_t );
+typedef void tgt_line_fn ( IOBUF *, char *, int, char *, int, BUF * );
 typedef void pred_fn ( ST_THR *, DHASH * );
 typedef void dupd_fn ( DHASH *, double, char );
 typedef void synth_fn( SYNTH * );
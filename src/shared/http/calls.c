@@ -96,6 +96,15 @@ int http_calls_stats( HTREQ *req )
 		json_insert( jt, "alloc", int,   ms.ctrs.total );
 		json_insert( jt, "kb",    int64, ( ms.bytes >> 10 ) );
 
+		if( ms.mag_size )
+		{
+			json_insert( jt, "magHits",    int64, ms.mag.hits );
+			json_insert( jt, "magMisses",  int64, ms.mag.misses );
+			json_insert( jt, "magSpills",  int64, ms.mag.spills );
+			json_insert( jt, "magCached",  int64, ms.mag.cached );
+			json_insert( jt, "magThreads", int,   ms.mag_threads );
+		}
+
 #ifdef MTYPE_TRACING
 		_jmtype( "alloc",  ms.ctrs.all );
 		_jmtype( "freed",  ms.ctrs.fre );
@@ -36,6 +36,9 @@ MEM_CTL *mem_config_defaults( void )
 	_mem              = (MEM_CTL *) allocz( sizeof( MEM_CTL ) );
 	_mem->perm        = perm;
 	_mem->prealloc    = DEFAULT_MEM_PRE_INTV;
+	_mem->trim_intv   = DEFAULT_MEM_TRIM_INTV;
+	_mem->watermark   = DEFAULT_MEM_TRIM_WMARK;
+	_mem->trim        = 1;
 
 	mc                = (MCHK *) mem_perm( sizeof( MCHK ) );
 	mc->max_kb        = DEFAULT_MEM_MAX_KB;
@@ -45,6 +48,9 @@ MEM_CTL *mem_config_defaults( void )
 
 	_mem->mcheck      = mc;
 
+	pthread_mutex_init( &(_mem->maglock), NULL );
+	pthread_key_create( &(_mem->magkey), &mtype_cache_release );
+
 	pthread_mutexattr_init( &(_mem->mtxa) );
 #ifdef DEFAULT_MUTEXES
 	pthread_mutexattr_settype( &(_mem->mtxa), PTHREAD_MUTEX_DEFAULT );
@@ -65,6 +71,10 @@ MEM_CTL *mem_config_defaults( void )
 	_mem->treel       = mem_type_declare( "treel",  sizeof( TEL ),    MEM_ALLOCSZ_TREEL, 0, 1 );
 	_mem->tleaf       = mem_type_declare( "tleaf",  sizeof( LEAF ),   MEM_ALLOCSZ_TLEAF, 0, 1 );
 
+	mem_type_magazine( _mem->iobufs, MEM_MAGSZ_IOBUF );
+	mem_type_magazine( _mem->hosts,  MEM_MAGSZ_HOSTS );
+	mem_type_magazine( _mem->ptlst,  MEM_MAGSZ_PTLST );
+
 	pthread_mutex_init( &(_mem->idlock), NULL );
 
 	return _mem;
@@ -99,6 +109,24 @@ int mem_config_line( AVP *av )
 			_mem->mcheck->checks = config_bool( av );
 		else if( attIs( "prealloc" ) || attIs( "preallocInterval" ) )
 			av_int( _mem->prealloc );
+		else if( attIs( "trim" ) )
+			_mem->trim = config_bool( av );
+		else if( attIs( "trimInterval" ) )
+			av_int( _mem->trim_intv );
+		else if( attIs( "trimWatermark" ) )
+		{
+			av_dbl( _mem->watermark );
+			if( _mem->watermark <= 0 || _mem->watermark >= 1 )
+			{
+				warn( "Invalid memory trim watermark %f - resetting to default.", _mem->watermark );
+				_mem->watermark = DEFAULT_MEM_TRIM_WMARK;
+			}
+
+			// set the ones not done individually
+			for( i = 0; i < MEM_TYPES_MAX && ( mt = _mem->types[i] ); ++i )
+				if( !mt->wm_set )
+					mt->watermark = _mem->watermark;
+		}
 		else
 			return -1;
 
@@ -138,6 +166,34 @@ int mem_config_line( AVP *av )
 		mt->prealloc = 0;
 		debug( "Preallocation disabled for %s", mt->name );
 	}
+	else if( attIs( "magazine" ) )
+	{
+		av_int( t );
+		mem_type_magazine( mt, ( t > 0 ) ? (uint32_t) t : 0 );
+		debug( "Thread magazine size for %s set to %u", mt->name, mt->mag_size );
+	}
+	else if( attIs( "trim" ) )
+	{
+		// it can only be turned off - the type says if it's safe
+		if( !config_bool( av ) )
+		{
+			mt->trim = 0;
+			debug( "Trimming disabled for %s", mt->name );
+		}
+	}
+	else if( attIs( "watermark" ) )
+	{
+		av_dbl( mt->watermark );
+		if( mt->watermark <= 0 || mt->watermark >= 1 )
+		{
+			warn( "Invalid memory trim watermark %f for %s - resetting to default.", mt->watermark, mt->name );
+			mt->watermark = _mem->watermark;
+		}
+		else
+			mt->wm_set = 1;
+
+		debug( "Mem trim watermark for %s is now %f", mt->name, mt->watermark );
+	}
 	else if( attIs( "threshold" ) )
 	{
 		av_dbl( mt->threshold );
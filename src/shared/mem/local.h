@@ -29,6 +29,9 @@
 
 #define DEFAULT_MEM_PRE_THRESH		0.33
 
+#define DEFAULT_MEM_TRIM_INTV		30000		// msec
+#define DEFAULT_MEM_TRIM_WMARK		0.6
+
 #define PERM_SPACE_BLOCK			0x100000   // 1M
 
 // and some types
@@ -45,6 +48,21 @@
 #define MEM_ALLOCSZ_TREEL			128		// 64b, so 8k
 #define MEM_ALLOCSZ_TLEAF			128		// ?
 
+// and thread magazine sizes, for the busy ones
+#define MEM_MAGSZ_IOBUF				8
+#define MEM_MAGSZ_HOSTS				8
+#define MEM_MAGSZ_PTLST				16
+
+// slabs are a power of two in size, and aligned to it
+#define MEM_SLAB_MIN_SIZE			0x10000		// 64k
+#define MEM_SLAB_MIN_OBJS			16
+#define MEM_SLAB_HDR_SZ				64
+
+#define mem_slab_of( mt, p )		((MSLAB *) ( (uintptr_t) (p) & ~( (uintptr_t) (mt)->slab_sz - 1 ) ))
+
+// the biggest thread magazine we allow
+#define MEM_MAG_MAX					1024
+
 // keep points on a PTL if it is less than this
 #define MEM_PTSER_MAX_KEEP_POINTS	3601
 
@@ -87,10 +105,59 @@ struct mem_type
 
 	double				threshold;
 
+	uint32_t			mag_size;	// 0 for no magazines
+	MTMCTR				mag_old;	// from threads that have gone
+
+	MSLAB			*	slabs;
+	uint32_t			slab_sz;	// bytes
+	uint32_t			slab_objs;	// structs per slab
+
+	int					trim;
+	int					wm_set;
+	double				watermark;	// free fraction we trim down to
+	mem_free_cb		*	release;	// frees what a free struct holds
+	int64_t				trimmed;	// bytes given back
+	PMET			*	pm_trim;
+
 	pthread_mutex_t		lock;
 };
 
 
+// a thread's own stock of one type - two magazines,
+// so alternating new and free at the edge of one
+// doesn't bounce off the type lock every time
+struct mem_magazine
+{
+	MTBLANK			*	load;
+	MTBLANK			*	ltail;
+	MTBLANK			*	prev;
+	MTBLANK			*	ptail;
+	uint32_t			lct;
+	uint32_t			pct;
+
+	MTMCTR				ctrs;
+};
+
+
+// sits at the start of each slab, structs after it
+struct mem_slab
+{
+	MSLAB			*	next;
+	MSLAB			*	prev;
+	uint32_t			count;
+	uint32_t			free;		// only counted when trimming
+	int					drop;
+};
+
+
+struct mem_thread_cache
+{
+	MTCACHE			*	next;
+	char				name[16];
+	MTMAG				mags[MEM_TYPES_MAX];
+};
+
+
 struct mem_check
 {
 	char			*	buf;
@@ -123,6 +190,11 @@ struct mem_perm
 loop_call_fn mem_prealloc;
 throw_fn mem_prealloc_loop;
 
+void mtype_cache_release( void *arg );
+
+loop_call_fn mem_trim;
+throw_fn mem_trim_loop;
+
 loop_call_fn mem_check;
 throw_fn mem_check_loop;
 
@@ -164,20 +164,57 @@ void mem_shutdown( void )
 	pthread_mutex_destroy( &(_mem->idlock) );
 }
 
+// trimming a type below what prealloc wants back just churns
+static void mem_trim_setup( void )
+{
+	MTYPE *mt;
+	int i;
+
+	if( !runf_has( RUN_NO_HTTP ) )
+	{
+		_mem->pm_src  = pmet_add_source( "memory" );
+		_mem->pm_trim = pmet_new( PMET_TYPE_COUNTER, "ministry_mem_trimmed_bytes",
+		                          "Bytes of free memory given back to the OS, by memory type" );
+	}
+
+	for( i = 0; i < MEM_TYPES_MAX; ++i )
+	{
+		if( !( mt = _mem->types[i] ) )
+			break;
+
+		if( !mt->trim )
+			continue;
+
+		if( mt->prealloc && mt->watermark <= mt->threshold )
+		{
+			warn( "Trim watermark %f for %s is not above its prealloc threshold %f - not trimming it.",
+				mt->watermark, mt->name, mt->threshold );
+			mt->trim = 0;
+			continue;
+		}
+
+		if( _mem->pm_trim )
+		{
+			mt->pm_trim = pmet_create_gen( _mem->pm_trim, _mem->pm_src, PMET_GEN_IVAL, &(mt->trimmed), NULL, NULL );
+			pmet_label_apply_item( pmet_label_create( "type", mt->name ), mt->pm_trim );
+		}
+	}
+}
+
+
 // do we do checks?
 void mem_startup( void )
 {
-	//PMET *p, *q;
-	//int i;
-
 	if( _mem->mcheck->checks )
 		thread_throw_named( &mem_check_loop, NULL, 0, "mem_check_loop" );
 
 	thread_throw_named( &mem_prealloc_loop, NULL, 0, "mem_prealloc" );
 
-	//if( !( p = pmet_create( PMET_TYPE_GAUGE,
-	//                "mem_allocation", "Amount of memory allocated",
-	//                PMET_GEN_FN, 
+	if( _mem->trim )
+	{
+		mem_trim_setup( );
+		thread_throw_named( &mem_trim_loop, NULL, 0, "mem_trim" );
+	}
 }
 
 
@@ -85,12 +85,34 @@ struct mem_type_counters
 };
 
 
+// thread magazine counters
+struct mem_mag_counters
+{
+	int64_t					hits;		// served without the type lock
+	int64_t					misses;		// had to refill
+	int64_t					spills;		// handed back a full magazine
+	int64_t					cached;		// sitting in magazines now
+};
+
+struct mem_mag_thread_stats
+{
+	char					name[16];
+	MTMCTR					ctrs;
+};
+
 struct mem_type_stats
 {
 	char				*	name;
 	uint64_t				bytes;
 
 	MTCTR					ctrs;
+
+	MTMCTR					mag;
+	uint32_t				mag_size;
+	int32_t					mag_threads;
+
+	int64_t					trimmed;	// bytes
+	int						trim;
 };
 
 struct mem_control
@@ -100,12 +122,21 @@ struct mem_control
 	MCHK				*	mcheck;
 
 	int64_t					prealloc;	// msec
+	int64_t					trim_intv;	// msec
+	double					watermark;
+	int						trim;
+	PMETS				*	pm_src;
+	PMETM				*	pm_trim;
 	int16_t					type_ct;
 	pthread_mutex_t			idlock;
 	uint64_t				id;
 
 	pthread_mutexattr_t		mtxa;
 
+	MTCACHE				*	caches;		// per-thread magazines
+	pthread_mutex_t			maglock;
+	pthread_key_t			magkey;
+
 	PERM				*	perm;		// permie string space
 
 	// known types
@@ -146,7 +177,10 @@ void mtype_free( MTYPE *mt, void *p );
 void mtype_free_list( MTYPE *mt, int count, void *first, void *last );
 
 MTYPE *mem_type_declare( char *name, int sz, int ct, int extra, uint32_t pre );
+void mem_type_magazine( MTYPE *mt, uint32_t size );
+void mem_type_trimmable( MTYPE *mt, mem_free_cb *release );
 int mem_type_stats( int id, MTSTAT *ms );
+int mem_type_mag_stats( int id, MTMTS *list, int max );
 int64_t mem_curr_kb( void );
 int64_t mem_virt_kb( void );
 void mem_set_max_kb( int64_t kb );
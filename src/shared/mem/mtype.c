@@ -36,13 +36,62 @@ void __mtype_report_counts( MTYPE *mt )
 }
 
 
+/*
+ *  Structs come from slabs - a power of two in size, aligned to that
+ *  size, so the slab header at the start can be found from any struct
+ *  in it.  That lets the trimmer work out which slabs have nothing in
+ *  use, and hand them back to the kernel when a type has far more free
+ *  than it needs, which is what a one-off spike in paths leaves behind.
+ *
+ *  Only types that say they can be trimmed are - anything a free struct
+ *  still holds on to has to be let go of first, and the type says how.
+ */
+
+
+// needs to fit a decent number of structs, and be a power of two
+static void __mtype_slab_size( MTYPE *mt )
+{
+	uint32_t sz;
+
+	for( sz = MEM_SLAB_MIN_SIZE; ( ( sz - MEM_SLAB_HDR_SZ ) / mt->alloc_sz ) < MEM_SLAB_MIN_OBJS; sz <<= 1 );
+
+	mt->slab_sz   = sz;
+	mt->slab_objs = ( sz - MEM_SLAB_HDR_SZ ) / mt->alloc_sz;
+}
+
+
+// map twice the size and trim it to alignment
+static MSLAB *__mtype_slab_map( MTYPE *mt )
+{
+	uintptr_t raw, al, sz;
+	void *vp;
+
+	sz = (uintptr_t) mt->slab_sz;
+	vp = mmap( NULL, 2 * sz, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0 );
+
+	if( vp == MAP_FAILED )
+		fatal( "Failed to map a %u byte slab for %s -- %s", mt->slab_sz, mt->name, Err );
+
+	raw = (uintptr_t) vp;
+	al  = ( raw + sz - 1 ) & ~( sz - 1 );
+
+	if( al > raw )
+		munmap( vp, al - raw );
+	if( ( al + sz ) < ( raw + 2 * sz ) )
+		munmap( (void *) ( al + sz ), raw + sz - al );
+
+	return (MSLAB *) al;
+}
+
+
 // grab some more memory of the proper size
 // must be called inside a lock
 void __mtype_alloc_free( MTYPE *mt, int count, int prefetch )
 {
-	MTBLANK *p, *list;
-	void *vp;
-	int i;
+	MTBLANK *p, *list, *first;
+	uint32_t i, j, ns;
+	MSLAB *s;
+	char *cp;
 
 	if( count <= 0 )
 		count = mt->alloc_ct;
@@ -64,10 +113,9 @@ void __mtype_alloc_free( MTYPE *mt, int count, int prefetch )
 		//mt->ctrs.fcount = i;
 	}
 
-	list = (MTBLANK *) allocz( mt->alloc_sz * count );
-
-	if( !list )
-		fatal( "Failed to allocate %d * %d bytes.", mt->alloc_sz, count );
+	// whole slabs only
+	ns    = ( (uint32_t) count + mt->slab_objs - 1 ) / mt->slab_objs;
+	count = (int) ( ns * mt->slab_objs );
 
 	mt->ctrs.fcount += count;
 	mt->ctrs.total  += count;
@@ -85,117 +133,259 @@ void __mtype_alloc_free( MTYPE *mt, int count, int prefetch )
 	}
 #endif
 
-	// the last one needs next -> flist so decrement count
-	count--;
-
-	vp = list;
-	p  = list;
+	list = mt->flist;
 
-	// link them up
-	for( i = 0; i < count; ++i )
+	for( i = 0; i < ns; ++i )
 	{
-#ifdef __GNUC__
-#if __GNUC_PREREQ(4,8)
-#pragma GCC diagnostic ignored "-Wpointer-arith"
-#pragma GCC diagnostic ignored "-Wpedantic"
-#endif
-#endif
-		// yes GCC, I know what I'm doing, thanks
-		//
-		// We allocate memory of sz * count
-		// Then step through it by sz, allocating
-		// the next pointers of the generic MTBLANK
-		// list.  When we are asked for a struct off
-		// this list, we explicitly cast it, so the
-		// next pointer of the desired struct points
-		// upwards by the size of the desired struct
-		// 
-		// But GCC freaks out because it's noticed
-		// we are adding more than the size of the
-		// struct size to vp, ie, not doing vp++
-		// and wonders if it's a bug.
-		vp     += mt->alloc_sz;
-#ifdef __GNUC__
-#if __GNUC_PREREQ(4,8)
-#pragma GCC diagnostic pop
-#pragma GCC diagnostic pop
-#endif
-#endif
-		p->next = (MTBLANK *) vp;
-		p       = p->next;
-	}
+		// fresh mappings come zeroed
+		s = __mtype_slab_map( mt );
+		s->count = mt->slab_objs;
+
+		s->next = mt->slabs;
+		if( mt->slabs )
+			mt->slabs->prev = s;
+		mt->slabs = s;
 
-	// and attach to the free list (it might not be null)
-	p->next = mt->flist;
+		// link up the structs, stepping by the real size
+		cp    = (char *) s + MEM_SLAB_HDR_SZ;
+		first = (MTBLANK *) cp;
+
+		for( p = first, j = 1; j < mt->slab_objs; ++j )
+		{
+			cp     += mt->alloc_sz;
+			p->next = (MTBLANK *) cp;
+			p       = p->next;
+		}
+
+		// and attach to the free list (it might not be null)
+		p->next = list;
+		list    = first;
+	}
 
 	// and update our type
 	mt->flist = list;
 }
 
 
-inline void *mtype_new( MTYPE *mt )
+/*
+ *  Each thread keeps a couple of magazines of each type that has them
+ *  turned on, and news and frees come out of and go back into those
+ *  without touching the type lock.  An empty thread refills a whole
+ *  magazine from the free list in one go, and a thread with both its
+ *  magazines full hands one of them back in one go.  Holding two means a
+ *  thread that news and frees one at a time, right at the boundary,
+ *  doesn't hit the lock on every call.
+ *
+ *  Objects parked in magazines are not on the free list, so fcount
+ *  doesn't count them - the stats say how many there are.  When a thread
+ *  ends, its magazines go back on the free lists.
+ */
+
+static __thread MTCACHE *mtype_cache = NULL;
+
+
+// takes count off the free list, and says where it ends
+static MTBLANK *__mtype_take( MTYPE *mt, uint32_t count, MTBLANK **last )
 {
-	MTBLANK *b;
+	MTBLANK *top, *end;
+	uint32_t i;
 
 	mem_lock( mt );
 
-	if( !mt->ctrs.fcount || !mt->flist )
+	// get enough
+	while( mt->ctrs.fcount < count )
 		__mtype_alloc_free( mt, 0, 0 );
 
-	b = mt->flist;
-	mt->flist = b->next;
+	top = end = mt->flist;
 
-	--(mt->ctrs.fcount);
+	// run down count - 1 elements
+	for( i = count - 1; i > 0; --i )
+		end = end->next;
+
+	// end is now the last in the list we want
+	mt->flist = end->next;
+	mt->ctrs.fcount -= count;
 
 #ifdef MTYPE_TRACING
 	++(mt->ctrs.all.ctr);
-	++(mt->ctrs.all.sum);
+	mt->ctrs.all.sum += count;
 #endif
 
 	mem_unlock( mt );
 
+	end->next = NULL;
+	*last     = end;
+
+	return top;
+}
+
+
+static MTCACHE *mtype_cache_create( void )
+{
+	MTCACHE *c = (MTCACHE *) allocz( sizeof( MTCACHE ) );
+
+	// unnamed threads get the process name
+	pthread_getname_np( pthread_self( ), c->name, 16 );
+
+	pthread_mutex_lock( &(_mem->maglock) );
+	c->next = _mem->caches;
+	_mem->caches = c;
+	pthread_mutex_unlock( &(_mem->maglock) );
+
+	pthread_setspecific( _mem->magkey, c );
+
+	return c;
+}
+
+
+// a thread is ending - give everything back
+void mtype_cache_release( void *arg )
+{
+	MTCACHE *c = (MTCACHE *) arg, **cp;
+	MTYPE *mt;
+	MTMAG *m;
+	int i;
+
+	pthread_mutex_lock( &(_mem->maglock) );
+
+	for( cp = &(_mem->caches); *cp; cp = &((*cp)->next) )
+		if( *cp == c )
+		{
+			*cp = c->next;
+			break;
+		}
+
+	for( i = 0; i < _mem->type_ct; ++i )
+	{
+		mt = _mem->types[i];
+		m  = c->mags + i;
+
+		if( m->lct )
+			mtype_free_list( mt, m->lct, m->load, m->ltail );
+		if( m->pct )
+			mtype_free_list( mt, m->pct, m->prev, m->ptail );
+
+		mt->mag_old.hits   += m->ctrs.hits;
+		mt->mag_old.misses += m->ctrs.misses;
+		mt->mag_old.spills += m->ctrs.spills;
+	}
+
+	pthread_mutex_unlock( &(_mem->maglock) );
+
+	mtype_cache = NULL;
+	free( c );
+}
+
+
+static inline MTMAG *mtype_mag( MTYPE *mt )
+{
+	if( !mtype_cache )
+		mtype_cache = mtype_cache_create( );
+
+	return mtype_cache->mags + mt->id;
+}
+
+
+__attribute__((hot)) static inline void *mtype_mag_new( MTYPE *mt, MTMAG *m )
+{
+	MTBLANK *b, *t;
+	uint32_t c;
+
+	if( m->lct )
+		++(m->ctrs.hits);
+	else if( m->pct )
+	{
+		// swap in the spare
+		b = m->load;  m->load  = m->prev;  m->prev  = b;
+		t = m->ltail; m->ltail = m->ptail; m->ptail = t;
+		c = m->lct;   m->lct   = m->pct;   m->pct   = c;
+
+		++(m->ctrs.hits);
+	}
+	else
+	{
+		m->load = __mtype_take( mt, mt->mag_size, &(m->ltail) );
+		m->lct  = mt->mag_size;
+
+		++(m->ctrs.misses);
+	}
+
+	b = m->load;
+	m->load = b->next;
+	--(m->lct);
+
 	b->next = NULL;
 
 	return (void *) b;
 }
 
 
-inline void *mtype_new_list( MTYPE *mt, int count )
+__attribute__((hot)) static inline void mtype_mag_free( MTYPE *mt, MTMAG *m, MTBLANK *b )
 {
-	MTBLANK *top, *end;
-	uint32_t c, i;
+	if( m->lct >= mt->mag_size )
+	{
+		// both full?  hand the spare back
+		if( m->pct )
+		{
+			mtype_free_list( mt, m->pct, m->prev, m->ptail );
+			++(m->ctrs.spills);
+		}
 
-	if( count <= 0 )
-		return NULL;
+		m->prev  = m->load;
+		m->ptail = m->ltail;
+		m->pct   = m->lct;
+		m->load  = NULL;
+		m->lct   = 0;
+	}
+
+	if( !m->lct )
+		m->ltail = b;
+
+	b->next = m->load;
+	m->load = b;
+	++(m->lct);
+}
+
+
+
+inline void *mtype_new( MTYPE *mt )
+{
+	MTBLANK *b;
 
-	c = (uint32_t) count;
+	if( mt->mag_size )
+		return mtype_mag_new( mt, mtype_mag( mt ) );
 
 	mem_lock( mt );
 
-	// get enough
-	while( mt->ctrs.fcount < c )
+	if( !mt->ctrs.fcount || !mt->flist )
 		__mtype_alloc_free( mt, 0, 0 );
 
-	top = end = mt->flist;
-
-	// run down count - 1 elements
-	for( i = c - 1; i > 0; --i )
-		end = end->next;
+	b = mt->flist;
+	mt->flist = b->next;
 
-	// end is now the last in the list we want
-	mt->flist = end->next;
-	mt->ctrs.fcount -= c;
+	--(mt->ctrs.fcount);
 
 #ifdef MTYPE_TRACING
 	++(mt->ctrs.all.ctr);
-	mt->ctrs.all.sum += c;
+	++(mt->ctrs.all.sum);
 #endif
 
 	mem_unlock( mt );
 
-	end->next = NULL;
+	b->next = NULL;
+
+	return (void *) b;
+}
+
+
+inline void *mtype_new_list( MTYPE *mt, int count )
+{
+	MTBLANK *end;
+
+	if( count <= 0 )
+		return NULL;
 
-	return (void *) top;
+	return (void *) __mtype_take( mt, (uint32_t) count, &end );
 }
 
 
@@ -204,6 +394,12 @@ inline void mtype_free( MTYPE *mt, void *p )
 {
 	MTBLANK *b = (MTBLANK *) p;
 
+	if( mt->mag_size )
+	{
+		mtype_mag_free( mt, mtype_mag( mt ), b );
+		return;
+	}
+
 	mem_lock( mt );
 
 	b->next   = mt->flist;
@@ -293,6 +489,127 @@ void mem_prealloc_loop( THRD *t )
 
 
 
+// pull fully free slabs off the free list until we are under
+// the watermark, and give them back
+void mem_trim_one( MTYPE *mt )
+{
+	MSLAB *s, *next, *drop = NULL;
+	int64_t want, got, keep, used;
+	MTBLANK **bp, *b;
+	uint32_t j;
+	char *cp;
+
+	mem_lock( mt );
+
+	// keep the free share of the total at the watermark, but never
+	// go below what we started with, or prealloc just puts it back
+	used = mt->ctrs.total - mt->ctrs.fcount;
+	keep = (int64_t) ( used * mt->watermark / ( 1 - mt->watermark ) );
+
+	if( keep < 4 * mt->alloc_ct )
+		keep = 4 * mt->alloc_ct;
+
+	want = mt->ctrs.fcount - keep;
+
+	if( want < mt->slab_objs )
+	{
+		mem_unlock( mt );
+		return;
+	}
+
+	for( s = mt->slabs; s; s = s->next )
+		s->free = 0;
+
+	for( b = mt->flist; b; b = b->next )
+		++(mem_slab_of( mt, b )->free);
+
+	for( got = 0, s = mt->slabs; s && got < want; s = s->next )
+		if( s->free == s->count )
+		{
+			s->drop = 1;
+			got += s->count;
+		}
+
+	if( !got )
+	{
+		mem_unlock( mt );
+		return;
+	}
+
+	// unhook their structs
+	for( bp = &(mt->flist); *bp; )
+	{
+		if( mem_slab_of( mt, *bp )->drop )
+			*bp = (*bp)->next;
+		else
+			bp = &((*bp)->next);
+	}
+
+	// and the slabs themselves
+	for( s = mt->slabs; s; s = next )
+	{
+		next = s->next;
+
+		if( !s->drop )
+			continue;
+
+		if( s->prev )
+			s->prev->next = s->next;
+		else
+			mt->slabs = s->next;
+
+		if( s->next )
+			s->next->prev = s->prev;
+
+		s->next = drop;
+		drop    = s;
+	}
+
+	mt->ctrs.fcount -= got;
+	mt->ctrs.total  -= got;
+
+	mem_unlock( mt );
+
+	// nobody else can see them now
+	for( s = drop; s; s = next )
+	{
+		next = s->next;
+
+		if( mt->release )
+			for( cp = (char *) s + MEM_SLAB_HDR_SZ, j = 0; j < s->count; ++j, cp += mt->alloc_sz )
+				(*(mt->release))( cp );
+
+		munmap( s, mt->slab_sz );
+		mt->trimmed += mt->slab_sz;
+	}
+
+	debug( "Trimmed %ld free slots from %s.", got, mt->name );
+}
+
+
+void mem_trim( int64_t tval, void *arg )
+{
+	MTYPE *mt;
+	int i;
+
+	for( i = 0; i < MEM_TYPES_MAX; ++i )
+	{
+		if( !( mt = _mem->types[i] ) )
+			break;
+
+		if( mt->trim )
+			mem_trim_one( mt );
+	}
+}
+
+
+void mem_trim_loop( THRD *t )
+{
+	loop_control( "memory trim", mem_trim, NULL, 1000 * _mem->trim_intv, LOOP_TRIM, 0 );
+}
+
+
+
 MTYPE *mem_type_declare( char *name, int sz, int ct, int extra, uint32_t pre )
 {
 	MTYPE *mt;
@@ -304,6 +621,9 @@ MTYPE *mem_type_declare( char *name, int sz, int ct, int extra, uint32_t pre )
 	mt->name      = str_perm( name, 0 );
 	mt->threshold = DEFAULT_MEM_PRE_THRESH;
 	mt->prealloc  = pre;
+	mt->watermark = DEFAULT_MEM_TRIM_WMARK;
+
+	__mtype_slab_size( mt );
 
 	// get our ID, and place us in the list
 	mt->id        = _mem->type_ct++;
@@ -320,9 +640,32 @@ MTYPE *mem_type_declare( char *name, int sz, int ct, int extra, uint32_t pre )
 }
 
 
+// say this type can give memory back
+void mem_type_trimmable( MTYPE *mt, mem_free_cb *release )
+{
+	mt->trim    = 1;
+	mt->release = release;
+}
+
+
+// only safe before any threads are using the type
+void mem_type_magazine( MTYPE *mt, uint32_t size )
+{
+	if( size > MEM_MAG_MAX )
+	{
+		warn( "Magazine size %u for %s is too big - capping at %d.", size, mt->name, MEM_MAG_MAX );
+		size = MEM_MAG_MAX;
+	}
+
+	mt->mag_size = size;
+}
+
+
 int mem_type_stats( int id, MTSTAT *ms )
 {
 	MTYPE *m = _mem->types[id];
+	MTCACHE *c;
+	MTMAG *g;
 
 	memset( ms, 0, sizeof( MTSTAT ) );
 
@@ -337,9 +680,79 @@ int mem_type_stats( int id, MTSTAT *ms )
 	// these can be after the unlock
 	ms->bytes = (uint64_t) m->stats_sz * (uint64_t) ms->ctrs.total;
 	ms->name = m->name;
+	ms->trim = m->trim;
+	ms->trimmed = m->trimmed;
+
+	if( ( ms->mag_size = m->mag_size ) )
+	{
+		// the threads' counters are only read here
+		pthread_mutex_lock( &(_mem->maglock) );
+
+		ms->mag = m->mag_old;
+
+		for( c = _mem->caches; c; c = c->next )
+		{
+			g = c->mags + id;
+
+			if( !g->ctrs.hits && !g->ctrs.misses && !g->lct && !g->pct )
+				continue;
+
+			ms->mag.hits   += g->ctrs.hits;
+			ms->mag.misses += g->ctrs.misses;
+			ms->mag.spills += g->ctrs.spills;
+			ms->mag.cached += g->lct + g->pct;
+			++(ms->mag_threads);
+		}
+
+		pthread_mutex_unlock( &(_mem->maglock) );
+	}
 
 	return 0;
 }
 
 
+// per-thread magazine counters, merged by thread name
+int mem_type_mag_stats( int id, MTMTS *list, int max )
+{
+	MTCACHE *c;
+	MTMAG *g;
+	int i, n;
+
+	if( id >= _mem->type_ct || !_mem->types[id]->mag_size )
+		return 0;
+
+	pthread_mutex_lock( &(_mem->maglock) );
+
+	for( n = 0, c = _mem->caches; c; c = c->next )
+	{
+		g = c->mags + id;
+
+		if( !g->ctrs.hits && !g->ctrs.misses )
+			continue;
+
+		for( i = 0; i < n; ++i )
+			if( !strncmp( list[i].name, c->name, 16 ) )
+				break;
+
+		if( i == n )
+		{
+			if( n == max )
+				continue;
+
+			memset( list + n, 0, sizeof( MTMTS ) );
+			memcpy( list[n].name, c->name, 16 );
+			++n;
+		}
+
+		list[i].ctrs.hits   += g->ctrs.hits;
+		list[i].ctrs.misses += g->ctrs.misses;
+		list[i].ctrs.spills += g->ctrs.spills;
+		list[i].ctrs.cached += g->lct + g->pct;
+	}
+
+	pthread_mutex_unlock( &(_mem->maglock) );
+
+	return n;
+}
+
 
@@ -232,6 +232,7 @@ void mem_free_host( HOST **h )
 	sh->net->fd    = -1;
 	sh->net->flags = 0;
 	sh->lock_use   = 0;
+	sh->data_init  = 0;
 	sh->ipn        = NULL;
 	sh->ip         = 0;
 
@@ -67,6 +67,13 @@ int net_add_type( NET_TYPE *nt )
 		return -1;
 
 	nt->nlen = strlen( nt->name );
+
+	if( nt->udp_batch < 1 )
+		nt->udp_batch = DEFAULT_UDP_BATCH;
+
+	if( nt->udp_socks < 1 )
+		nt->udp_socks = 1;
+
 	nt->next = _net->ntypes;
 	_net->ntypes = nt;
 
@@ -341,6 +348,53 @@ int net_config_line( AVP *av )
 			ntflag( UDP_CHECKS );
 		}
 	}
+	else if( attIs( "batch" ) )
+	{
+		if( tcp )
+			warn( "Batch is only for UDP ports." );
+		else
+		{
+			if( av_int( v ) == NUM_INVALID )
+			{
+				err( "Invalid UDP batch size: %s", av->vptr );
+				return -1;
+			}
+			if( v < 1 || v > MAX_UDP_BATCH )
+			{
+				err( "UDP batch size must be 1 <= X <= %d.", MAX_UDP_BATCH );
+				return -1;
+			}
+
+			nt->udp_batch = v;
+		}
+	}
+	else if( attIs( "sockets" ) )
+	{
+		if( tcp )
+			warn( "Sockets is only for UDP ports." );
+		else
+		{
+			// one per core
+			if( !strcasecmp( av->vptr, "auto" ) )
+			{
+				if( ( v = sysconf( _SC_NPROCESSORS_ONLN ) ) > MAX_UDP_SOCKETS )
+					v = MAX_UDP_SOCKETS;
+			}
+			else if( av_int( v ) == NUM_INVALID )
+			{
+				err( "Invalid UDP sockets count: %s", av->vptr );
+				return -1;
+			}
+
+			if( v < 1 || v > MAX_UDP_SOCKETS )
+			{
+				err( "UDP sockets count must be 1 <= X <= %d.", MAX_UDP_SOCKETS );
+				return -1;
+			}
+
+			nt->udp_socks = v;
+		}
+	}
 	else if( attIs( "bind" ) )
 	{
 		inet_aton( av->vptr, &ina );
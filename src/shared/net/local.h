@@ -93,6 +93,19 @@ struct tcp_thread
 	int64_t					num;
 };
 
+
+// a ring of buffers for batched udp receives
+struct udp_batch
+{
+	struct mmsghdr		*	msgs;
+	struct iovec		*	iovs;
+	struct sockaddr_in	*	peers;
+	IOBUF				**	bufs;
+
+	int						count;
+};
+
+
 extern const struct tcp_style_data tcp_styles[];
 
 
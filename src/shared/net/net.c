@@ -238,7 +238,12 @@ void net_begin_type( NET_TYPE *nt )
 			fp = &udp_loop_flat;
 
 		for( i = 0; i < nt->udp_count; ++i )
-			thread_throw_named_f( fp, nt->udp[i], i, "udp_loop_%hu", nt->udp[i]->port );
+		{
+			if( nt->udp[i]->sock )
+				thread_throw_named_f( fp, nt->udp[i], i, "udp_%hu_%hu", nt->udp[i]->port, nt->udp[i]->sock );
+			else
+				thread_throw_named_f( fp, nt->udp[i], i, "udp_loop_%hu", nt->udp[i]->port );
+		}
 	}
 
 	info( "Started listening for data on %s", nt->label );
@@ -248,6 +253,38 @@ void net_begin_type( NET_TYPE *nt )
 
 
 
+// each configured udp port becomes several sockets bound to
+// the same port with SO_REUSEPORT, each with its own thread
+void ntype_udp_expand( NET_TYPE *nt )
+{
+	NET_PORT **list, *p;
+	int i, j, k = 0;
+
+	list = (NET_PORT **) mem_perm( nt->udp_count * nt->udp_socks * sizeof( NET_PORT * ) );
+
+	for( i = 0; i < nt->udp_count; ++i )
+		for( j = 0; j < nt->udp_socks; ++j )
+		{
+			if( j == 0 )
+				p = nt->udp[i];
+			else
+			{
+				p       = (NET_PORT *) mem_perm( sizeof( NET_PORT ) );
+				p->port = nt->udp[i]->port;
+				p->type = nt;
+			}
+
+			p->sock   = j + 1;
+			list[k++] = p;
+		}
+
+	info( "Type %s has %d udp sockets on each of %hu ports.", nt->name, nt->udp_socks, nt->udp_count );
+
+	nt->udp       = list;
+	nt->udp_count = k;
+}
+
+
 int ntype_startup( NET_TYPE *nt )
 {
 	int i, j;
@@ -275,12 +312,15 @@ int ntype_startup( NET_TYPE *nt )
 	notice( "Type %s has TCP dead time %ds, TCP handler style %s.",
 		nt->name, _net->dead_time, tcp_styles[nt->tcp_style].name );
 
+	if( nt->flags & NTYPE_UDP_ENABLED && nt->udp_socks > 1 )
+		ntype_udp_expand( nt );
+
 	if( nt->flags & NTYPE_UDP_ENABLED )
 		for( i = 0; i < nt->udp_count; ++i )
 		{
 			// grab the udp ip variable
 			nt->udp[i]->ip   = nt->udp_bind;
-			nt->udp[i]->fd = udp_listen( nt->udp[i]->port, nt->udp[i]->ip );
+			nt->udp[i]->fd = udp_listen( nt->udp[i]->port, nt->udp[i]->ip, nt->udp[i]->sock );
 			if( nt->udp[i]->fd < 0 )
 			{
 				if( nt->flags & NTYPE_TCP_ENABLED )
@@ -296,8 +336,8 @@ int ntype_startup( NET_TYPE *nt )
 				}
 				return -2;
 			}
-			debug( "Bound udp port %hu with socket %d",
-					nt->udp[i]->port, nt->udp[i]->fd );
+			debug( "Bound udp port %hu with socket %d (%hu)",
+					nt->udp[i]->port, nt->udp[i]->fd, nt->udp[i]->sock );
 		}
 
 	notice( "Started up %s", nt->label );
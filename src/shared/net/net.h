@@ -26,6 +26,9 @@
 #define NET_BUF_SZ						0x10000		// 64k
 #define DEFAULT_NET_BACKLOG				32
 #define TCP_MAX_POLLS					128
+#define DEFAULT_UDP_BATCH				16
+#define MAX_UDP_BATCH					1024
+#define MAX_UDP_SOCKETS					64
 
 
 #define NTYPE_ENABLED					0x0001
@@ -65,12 +68,18 @@ struct net_in_port
 
 	uint16_t				port;
 	uint16_t				back;
+	uint16_t				sock;	// reuseport socket number
 	uint32_t				ip;
 
 	LLCT					errors;
 	LLCT					drops;
 	LLCT					accepts;
 
+	// udp batch receive counters
+	LLCT					batches;
+	LLCT					bfull;
+	LLCT					rcvd;
+
 	HOST				**	phosts;
 	uint64_t				phsz;
 
@@ -89,6 +98,8 @@ struct net_type
 	uint16_t				flags;
 	uint16_t				udp_count;
 	uint32_t				udp_bind;
+	int32_t					udp_batch;
+	int32_t					udp_socks;
 
 	buf_fn				*	buf_parser;
 	line_fn				*	flat_parser;
@@ -149,6 +160,9 @@ struct host_data
 	// locking
 	pthread_mutex_t			lock;
 
+	// structural scan of the current line
+	SCANL				*	scan;
+
 	// filtering and rules
 	IPNET				*	ipn;		// may well be null
 	char				*	workbuf;	// gets set to fixed size
@@ -161,6 +175,8 @@ struct host_data
 	int8_t					lock_use;	// if we are using it this time
 	int8_t					lock_init;	// if we have init'd the lock
 
+	int8_t					data_init;	// if the app has looked at data yet
+
 	uint32_t				ip;			// easier than always hitting the peer
 };
 
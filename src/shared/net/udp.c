@@ -88,18 +88,121 @@ void udp_add_phost( void *arg, IPNET *ip )
 
 
 
+// make a ring of receive buffers, each with its own peer address,
+// so that recvmmsg can fill as many as are waiting in one syscall
+UDPBT *udp_batch_create( int count )
+{
+	struct msghdr *m;
+	UDPBT *ub;
+	int i;
+
+	ub        = (UDPBT *) allocz( sizeof( UDPBT ) );
+	ub->count = count;
+	ub->msgs  = (struct mmsghdr *) allocz( count * sizeof( struct mmsghdr ) );
+	ub->iovs  = (struct iovec *) allocz( count * sizeof( struct iovec ) );
+	ub->peers = (struct sockaddr_in *) allocz( count * sizeof( struct sockaddr_in ) );
+	ub->bufs  = (IOBUF **) allocz( count * sizeof( IOBUF * ) );
+
+	for( i = 0; i < count; ++i )
+	{
+		ub->bufs[i] = mem_new_iobuf( NET_BUF_SZ );
+
+		// we need to make room for a newline and a null for safety
+		ub->iovs[i].iov_base = ub->bufs[i]->bf->buf;
+		ub->iovs[i].iov_len  = ub->bufs[i]->bf->sz - 2;
+
+		m = &(ub->msgs[i].msg_hdr);
+		m->msg_name    = &(ub->peers[i]);
+		m->msg_iov     = &(ub->iovs[i]);
+		m->msg_iovlen  = 1;
+	}
+
+	return ub;
+}
+
+
+void udp_batch_free( UDPBT **b )
+{
+	UDPBT *ub;
+	int i;
+
+	if( !b || !*b )
+		return;
+
+	ub = *b;
+	*b = NULL;
+
+	for( i = 0; i < ub->count; ++i )
+		mem_free_iobuf( &(ub->bufs[i]) );
+
+	free( ub->bufs );
+	free( ub->peers );
+	free( ub->iovs );
+	free( ub->msgs );
+	free( ub );
+}
+
+
+// fetch as many packets as are waiting, up to the batch size
+// we block for the first one only, and the socket timeout
+// still applies to that
+static inline int udp_batch_recv( NET_PORT *n, UDPBT *ub )
+{
+	int i, rc;
+
+	// the kernel overwrites the name length
+	for( i = 0; i < ub->count; ++i )
+		ub->msgs[i].msg_hdr.msg_namelen = sizeof( struct sockaddr_in );
+
+	if( ( rc = recvmmsg( n->fd, ub->msgs, ub->count, MSG_WAITFORONE, NULL ) ) > 0 )
+	{
+		++(n->batches.count);
+		n->rcvd.count += rc;
+
+		if( rc == ub->count )
+			++(n->bfull.count);
+	}
+
+	return rc;
+}
+
+
+// set up the buffer for a single packet in the batch
+// and point the host at its sender
+static inline IOBUF *udp_batch_packet( UDPBT *ub, int i, HOST *h )
+{
+	IOBUF *ib = ub->bufs[i];
+	BUF *b = ib->bf;
+
+	b->len = ub->msgs[i].msg_len;
+
+	*(h->peer) = ub->peers[i];
+	h->ip      = h->peer->sin_addr.s_addr;
+
+	// make sure we end in a newline or else we will trip over
+	// ourself on daft apps that just send one line without a \n
+	// or join on \n but don't append a trailing one
+	if( b->buf[b->len-1] != '\n' )
+		b->buf[b->len++]  = '\n';
+
+	// and make sure to cap it all
+	buf_terminate( b );
+
+	return ib;
+}
+
+
+
 void udp_loop_checks( THRD *t )
 {
 	struct sockaddr_in sa;
-	struct sockaddr *sp;
-	socklen_t sl;
 	NET_PORT *n;
 	NET_PFX *p;
 	IPNET *ipn;
-	int sz, rb;
+	int i, rc;
+	UDPBT *ub;
 	IOBUF *ib;
 	HOST *h;
-	BUF *b;
 
 	n = (NET_PORT *) t->arg;
 
@@ -111,9 +214,9 @@ void udp_loop_checks( THRD *t )
 	n->phosts = (HOST **) mem_perm( NET_IP_HASHSZ * sizeof( HOST * ) );
 	n->phsz = NET_IP_HASHSZ;
 
-	h  = mem_new_host( &sa, NET_BUF_SZ );
-	ib = h->net->in;
-	b  = ib->bf;
+	// we don't need an input buffer on the host - the batch has them
+	h  = mem_new_host( &sa, 0 );
+	ub = udp_batch_create( n->type->udp_batch );
 
 	h->type = n->type;
 
@@ -126,61 +229,56 @@ void udp_loop_checks( THRD *t )
 
 	loop_mark_start( "udp" );
 
-	// we need to make room for a newline and a null for safety
-	sz = b->sz - 2;
-	// and let's not do constant casting
-	sp = (struct sockaddr *) h->peer;
-
 	while( RUNNING( ) )
 	{
-		// get a packet, set the from
-		sl = sizeof( struct sockaddr_in );
-		if( ( rb = recvfrom( n->fd, b->buf, sz, 0, sp, &sl ) ) < 0 )
+		// get a batch of packets
+		if( ( rc = udp_batch_recv( n, ub ) ) < 0 )
 		{
 			if( errno == EINTR || errno == EAGAIN )
 				continue;
 
 			++(n->errors.count);
-			err( "Recvfrom error -- %s", Err );
+			err( "Recvmmsg error -- %s", Err );
 			loop_end( "receive error on udp socket" );
 			break;
 		}
-		else if( !rb )
-			continue;
-
-		b->len = rb;
 
-		// do IP filter check
-		if( net_ip_check( _net->filter, h->peer ) != 0 )
+		for( i = 0; i < rc; ++i )
 		{
-			++(n->drops.count);
-			continue;
-		}
+			if( !ub->msgs[i].msg_len )
+				continue;
 
-		++(n->accepts.count);
+			ib = udp_batch_packet( ub, i, h );
 
-		// make sure we end in a newline or else we will trip over
-		// ourself on daft apps that just send one line without a \n
-		// or join on \n but don't append a trailing one
-		if( b->buf[b->len-1] != '\n' )
-			b->buf[b->len++]  = '\n';
+			// do IP filter check
+			if( net_ip_check( _net->filter, h->peer ) != 0 )
+			{
+				++(n->drops.count);
+				continue;
+			}
 
-		// and make sure to cap it all
-		buf_terminate( b );
+			++(n->accepts.count);
 
-		// do a prefix check on that
-		for( p = _net->prefix; p; p = p->next )
-			if( iplist_test_ip( p->list, h->ip, &ipn ) != IPLIST_NOMATCH )
-				break;
+			// do a prefix check on that
+			ipn = NULL;
+			for( p = _net->prefix; p; p = p->next )
+				if( iplist_test_ip( p->list, h->ip, &ipn ) != IPLIST_NOMATCH )
+					break;
 
-		if( ipn && ipn->tlen )
-			(*(h->receiver))( udp_get_phost( n, ipn ), ib );
-		else
-			(*(h->receiver))( h, ib );
+			if( ipn && ipn->tlen )
+				(*(h->receiver))( udp_get_phost( n, ipn ), ib );
+			else
+				(*(h->receiver))( h, ib );
+		}
 	}
 
 	loop_mark_done( "udp", 0, 0 );
 
+	udp_batch_free( &ub );
+
+	if( h->data && _net->host_finish )
+		(*(_net->host_finish))( h );
+
 	mem_free_host( &h );
 }
 
@@ -190,13 +288,11 @@ void udp_loop_checks( THRD *t )
 void udp_loop_flat( THRD *t )
 {
 	struct sockaddr_in sa;
-	struct sockaddr *sp;
-	socklen_t sl;
 	NET_PORT *n;
-	int sz, rb;
+	int i, rc;
+	UDPBT *ub;
 	IOBUF *ib;
 	HOST *h;
-	BUF *b;
 
 	n = (NET_PORT *) t->arg;
 
@@ -204,9 +300,9 @@ void udp_loop_flat( THRD *t )
 	sa.sin_addr.s_addr = n->ip;
 	sa.sin_port = htons( n->port );
 
-	h  = mem_new_host( &sa, NET_BUF_SZ );
-	ib = h->net->in;
-	b  = ib->bf;
+	// we don't need an input buffer on the host - the batch has them
+	h  = mem_new_host( &sa, 0 );
+	ub = udp_batch_create( n->type->udp_batch );
 
 	h->type   = n->type;
 	// for now we don't do prefixing or tokens on UDP
@@ -214,57 +310,51 @@ void udp_loop_flat( THRD *t )
 
 	loop_mark_start( "udp" );
 
-	// we need to make room for a newline and a null for safety
-	sz = b->sz - 2;
-	// and let's not do constant casting
-	sp = (struct sockaddr *) h->peer;
-
 	while( RUNNING( ) )
 	{
-		// get a packet, set the from
-		sl = sizeof( struct sockaddr_in );
-		if( ( rb = recvfrom( n->fd, b->buf, sz, 0, sp, &sl ) ) < 0 )
+		// get a batch of packets
+		if( ( rc = udp_batch_recv( n, ub ) ) < 0 )
 		{
 			if( errno == EINTR || errno == EAGAIN )
 				continue;
 
 			++(n->errors.count);
-			err( "Recvfrom error -- %s", Err );
+			err( "Recvmmsg error -- %s", Err );
 			loop_end( "receive error on udp socket" );
 			break;
 		}
-		else if( !rb )
-			continue;
-
-		b->len = rb;
 
-		++(n->accepts.count);
+		for( i = 0; i < rc; ++i )
+		{
+			if( !ub->msgs[i].msg_len )
+				continue;
 
-		// make sure we end in a newline or else we will trip over
-		// ourself on daft apps that just send one line without a \n
-		// or join on \n but don't append a trailing one
-		if( b->buf[b->len-1] != '\n' )
-			b->buf[b->len++]  = '\n';
+			ib = udp_batch_packet( ub, i, h );
 
-		// and make sure to cap it all
-		buf_terminate( b );
+			++(n->accepts.count);
 
-		// and try to parse that log
-		(*(h->receiver))( h, ib );
+			// and try to parse that log
+			(*(h->receiver))( h, ib );
+		}
 	}
 
 	loop_mark_done( "udp", 0, 0 );
 
+	udp_batch_free( &ub );
+
+	if( h->data && _net->host_finish )
+		(*(_net->host_finish))( h );
+
 	mem_free_host( &h );
 }
 
 
 
-int udp_listen( unsigned short port, uint32_t ip )
+int udp_listen( unsigned short port, uint32_t ip, int reuse )
 {
 	struct sockaddr_in sa;
 	struct timeval tv;
-	int s;
+	int s, so;
 
 	if( ( s = socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP ) ) < 0 )
 	{
@@ -284,6 +374,15 @@ int udp_listen( unsigned short port, uint32_t ip )
 		return -2;
 	}
 
+	// multiple sockets on one port need the kernel to spread flows
+	so = 1;
+	if( reuse && setsockopt( s, SOL_SOCKET, SO_REUSEPORT, &so, sizeof( int ) ) < 0 )
+	{
+		err( "Set reuseport option error for listen socket -- %s", Err );
+		close( s );
+		return -2;
+	}
+
 	memset( &sa, 0, sizeof( struct sockaddr_in ) );
 	sa.sin_family = AF_INET;
 	sa.sin_port   = htons( port );
@@ -25,7 +25,10 @@
 throw_fn udp_loop_flat;
 throw_fn udp_loop_checks;
 
-int udp_listen( unsigned short port, uint32_t ip );
+UDPBT *udp_batch_create( int count );
+void udp_batch_free( UDPBT **b );
+
+int udp_listen( unsigned short port, uint32_t ip, int reuse );
 
 iplist_data_fn udp_add_phost;
 
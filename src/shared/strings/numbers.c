@@ -0,0 +1,134 @@
+/**************************************************************************
+* Copyright 2015 John Denholm                                             *
+*                                                                         *
+* Licensed under the Apache License, Version 2.0 (the "License");         *
+* you may not use this file except in compliance with the License.        *
+* You may obtain a copy of the License at                                 *
+*                                                                         *
+*     http://www.apache.org/licenses/LICENSE-2.0                          *
+*                                                                         *
+* Unless required by applicable law or agreed to in writing, software     *
+* distributed under the License is distributed on an "AS IS" BASIS,       *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.*
+* See the License for the specific language governing permissions and     *
+* limitations under the License.                                          *
+*                                                                         *
+*                                                                         *
+* strings/numbers.c - fast number parsing for data values                 *
+*                                                                         *
+* Updates:                                                                *
+**************************************************************************/
+
+#include "local.h"
+
+
+// powers of ten that are exactly representable as a double
+static const double str_dbl_pow10[STR_DBL_MAX_POW10 + 1] =
+{
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+	1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+	1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+
+
+// parse a double the way data values arrive: an optional sign,
+// digits, an optional fraction and an optional exponent.  Anything
+// we cannot get exactly right (long mantissas, big exponents, hex,
+// inf/nan) goes to strtod, which rounds correctly.
+//
+// When the mantissa fits in 53 bits and the power of ten is exact,
+// one multiply or divide gives the correctly rounded answer.
+__attribute__((hot)) double str_to_dbl( const char *str, char **end )
+{
+	register const char *p = str;
+	register uint64_t m = 0;
+	int neg = 0, nd = 0, ex = 0, ee, eneg;
+	const char *q;
+	double v;
+
+	while( *p == ' ' || *p == '\t' )
+		++p;
+
+	if( *p == '-' )
+	{
+		neg = 1;
+		++p;
+	}
+	else if( *p == '+' )
+		++p;
+
+	// short integers are the common case
+	while( *p >= '0' && *p <= '9' )
+	{
+		m = ( m * 10 ) + ( *p++ - '0' );
+		++nd;
+	}
+
+	if( *p == '.' )
+	{
+		++p;
+		while( *p >= '0' && *p <= '9' )
+		{
+			m = ( m * 10 ) + ( *p++ - '0' );
+			++nd;
+			--ex;
+		}
+	}
+
+	// no digits at all - nothing parsed, or inf/nan
+	if( !nd )
+	{
+		if( *p == 'i' || *p == 'I' || *p == 'n' || *p == 'N' )
+			return strtod( str, end );
+
+		if( end )
+			*end = (char *) str;
+		return 0;
+	}
+
+	// an exponent only counts if it has digits
+	if( *p == 'e' || *p == 'E' )
+	{
+		q    = p + 1;
+		eneg = 0;
+
+		if( *q == '-' )
+		{
+			eneg = 1;
+			++q;
+		}
+		else if( *q == '+' )
+			++q;
+
+		if( *q >= '0' && *q <= '9' )
+		{
+			for( ee = 0; *q >= '0' && *q <= '9'; ++q )
+				if( ee < 10000 )
+					ee = ( ee * 10 ) + ( *q - '0' );
+
+			ex += ( eneg ) ? -ee : ee;
+			p   = q;
+		}
+	}
+
+	// too many digits for our mantissa, hex, or an
+	// exponent we can't apply exactly - the slow path
+	if( nd > STR_DBL_MAX_DIGITS || m > STR_DBL_MAX_MANT
+	 || ex > STR_DBL_MAX_POW10 || ex < -STR_DBL_MAX_POW10
+	 || *p == 'x' || *p == 'X' )
+		return strtod( str, end );
+
+	if( end )
+		*end = (char *) p;
+
+	v = (double) m;
+
+	if( ex > 0 )
+		v *= str_dbl_pow10[ex];
+	else if( ex < 0 )
+		v /= str_dbl_pow10[-ex];
+
+	return ( neg ) ? -v : v;
+}
+
@@ -0,0 +1,207 @@
+/**************************************************************************
+* Copyright 2015 John Denholm                                             *
+*                                                                         *
+* Licensed under the Apache License, Version 2.0 (the "License");         *
+* you may not use this file except in compliance with the License.        *
+* You may obtain a copy of the License at                                 *
+*                                                                         *
+*     http://www.apache.org/licenses/LICENSE-2.0                          *
+*                                                                         *
+* Unless required by applicable law or agreed to in writing, software     *
+* distributed under the License is distributed on an "AS IS" BASIS,       *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.*
+* See the License for the specific language governing permissions and     *
+* limitations under the License.                                          *
+*                                                                         *
+*                                                                         *
+* strings/scan.c - find line and field boundaries in one pass             *
+*                                                                         *
+* Updates:                                                                *
+**************************************************************************/
+
+#include "local.h"
+
+#if defined( __x86_64__ )
+#include <immintrin.h>
+#define STR_SCAN_X86
+#endif
+
+
+// We look at the buffer 64 bytes at a time, making a bitmask for
+// newlines and for each field separator.  Walking the newline mask
+// gives us the lines, and the lowest separator bit below each newline
+// gives us where the fields split, so the line parsers never have to
+// search the line again.
+
+
+typedef void str_scan_fn ( const char *p, const uint8_t *ch, int nc, uint64_t *m );
+
+static str_scan_fn *str_scan_block = NULL;
+
+
+
+static void str_scan_block_scalar( const char *p, const uint8_t *ch, int nc, uint64_t *m )
+{
+	int i, j;
+
+	for( i = 0; i < nc; ++i )
+		m[i] = 0;
+
+	for( j = 0; j < STR_SCAN_BLOCK; ++j )
+		for( i = 0; i < nc; ++i )
+			if( (uint8_t) p[j] == ch[i] )
+			{
+				m[i] |= 1UL << j;
+				break;
+			}
+}
+
+
+#ifdef STR_SCAN_X86
+
+static void str_scan_block_sse2( const char *p, const uint8_t *ch, int nc, uint64_t *m )
+{
+	__m128i a, b, c, d, x;
+	int i;
+
+	a = _mm_loadu_si128( (const __m128i *) p );
+	b = _mm_loadu_si128( (const __m128i *) ( p + 16 ) );
+	c = _mm_loadu_si128( (const __m128i *) ( p + 32 ) );
+	d = _mm_loadu_si128( (const __m128i *) ( p + 48 ) );
+
+	for( i = 0; i < nc; ++i )
+	{
+		x = _mm_set1_epi8( (char) ch[i] );
+
+		m[i] =   (uint64_t) (uint16_t) _mm_movemask_epi8( _mm_cmpeq_epi8( a, x ) )
+		     | ( (uint64_t) (uint16_t) _mm_movemask_epi8( _mm_cmpeq_epi8( b, x ) ) << 16 )
+		     | ( (uint64_t) (uint16_t) _mm_movemask_epi8( _mm_cmpeq_epi8( c, x ) ) << 32 )
+		     | ( (uint64_t) (uint16_t) _mm_movemask_epi8( _mm_cmpeq_epi8( d, x ) ) << 48 );
+	}
+}
+
+
+__attribute__((target("avx2"))) static void str_scan_block_avx2( const char *p, const uint8_t *ch, int nc, uint64_t *m )
+{
+	__m256i a, b, x;
+	int i;
+
+	a = _mm256_loadu_si256( (const __m256i *) p );
+	b = _mm256_loadu_si256( (const __m256i *) ( p + 32 ) );
+
+	for( i = 0; i < nc; ++i )
+	{
+		x = _mm256_set1_epi8( (char) ch[i] );
+
+		m[i] =   (uint64_t) (uint32_t) _mm256_movemask_epi8( _mm256_cmpeq_epi8( a, x ) )
+		     | ( (uint64_t) (uint32_t) _mm256_movemask_epi8( _mm256_cmpeq_epi8( b, x ) ) << 32 );
+	}
+}
+
+#endif
+
+
+static void str_scan_choose( void )
+{
+#ifdef STR_SCAN_X86
+	__builtin_cpu_init( );
+
+	if( __builtin_cpu_supports( "avx2" ) )
+		str_scan_block = &str_scan_block_avx2;
+	else if( __builtin_cpu_supports( "sse2" ) )
+		str_scan_block = &str_scan_block_sse2;
+	else
+		str_scan_block = &str_scan_block_scalar;
+#else
+	str_scan_block = &str_scan_block_scalar;
+#endif
+}
+
+
+
+// find up to max complete lines in buf, recording the offset of the
+// first of each separator character on each one (or -1).  Returns
+// how many lines were found - anything after the last of them is a
+// partial line, or there are more lines than max and the caller
+// should come back from the end of the last one.
+__attribute__((hot)) int str_scan_lines( const char *buf, int len, const char *seps, SCANL *lines, int max )
+{
+	int32_t sp[STR_SCAN_SEPS], ls = 0, base, rem;
+	uint64_t m[STR_SCAN_SEPS + 1], below;
+	uint8_t ch[STR_SCAN_SEPS + 1];
+	char tail[STR_SCAN_BLOCK];
+	int i, j, b, n = 0, nc;
+
+	if( !str_scan_block )
+		str_scan_choose( );
+
+	ch[0] = '\n';
+	for( nc = 1; nc <= STR_SCAN_SEPS && seps[nc-1]; ++nc )
+		ch[nc] = (uint8_t) seps[nc-1];
+
+	for( i = 0; i < STR_SCAN_SEPS; ++i )
+		sp[i] = -1;
+
+	for( base = 0; base < len; base += STR_SCAN_BLOCK )
+	{
+		if( ( rem = len - base ) >= STR_SCAN_BLOCK )
+			(*str_scan_block)( buf + base, ch, nc, m );
+		else
+		{
+			// nulls never match, so the padding is safe
+			memset( tail, 0, STR_SCAN_BLOCK );
+			memcpy( tail, buf + base, rem );
+			(*str_scan_block)( tail, ch, nc, m );
+		}
+
+		while( m[0] )
+		{
+			b     = __builtin_ctzl( m[0] );
+			below = ( 1UL << b ) - 1;
+
+			// first separators before this newline, then
+			// clear everything up to and including it
+			for( i = 1; i < nc; ++i )
+			{
+				if( sp[i-1] < 0 && ( m[i] & below ) )
+					sp[i-1] = base + __builtin_ctzl( m[i] & below ) - ls;
+
+				m[i] &= ~below;
+			}
+
+			lines[n].off = ls;
+			lines[n].len = base + b - ls;
+
+			for( j = 0; j < STR_SCAN_SEPS; ++j )
+			{
+				lines[n].sep[j] = sp[j];
+				sp[j] = -1;
+			}
+
+			if( ++n == max )
+				return n;
+
+			ls    = base + b + 1;
+			m[0] &= m[0] - 1;
+		}
+
+		// anything left belongs to the line still going
+		for( i = 1; i < nc; ++i )
+			if( sp[i-1] < 0 && m[i] )
+				sp[i-1] = base + __builtin_ctzl( m[i] ) - ls;
+	}
+
+	return n;
+}
+
+
+// a line lost its first character (a leading \r)
+void str_scan_shift( SCANL *l )
+{
+	int i;
+
+	for( i = 0; i < STR_SCAN_SEPS; ++i )
+		if( l->sep[i] > 0 )
+			--(l->sep[i]);
+}
+
@@ -38,6 +38,20 @@ struct words_data
 	char					sep;
 };
 
+// fast double parsing limits
+#define STR_DBL_MAX_DIGITS				19
+#define STR_DBL_MAX_POW10				22
+#define STR_DBL_MAX_MANT				0x20000000000000UL		// 2^53
+
+// structural scan of data lines
+#define STR_SCAN_BLOCK					64
+#define STR_SCAN_SEPS					3
+#define STR_SCAN_LINES					256
+#define STR_SCAN_FIELD_SEPS				" :|"
+#define STR_SCAN_SPACE					0
+#define STR_SCAN_COLON					1
+#define STR_SCAN_PIPE					2
+
 #define STRSTORE_FLAG_FREEABLE			0x0001
 #define STRSTORE_FLAG_VALID				0x0002
 
@@ -54,6 +68,16 @@ struct string_store_entry
 };
 
 
+// one line from a structural scan - separator offsets are
+// from the start of the line, or -1 if not present
+struct str_scan_line
+{
+	int32_t					off;
+	int32_t					len;
+	int32_t					sep[STR_SCAN_SEPS];
+};
+
+
 struct string_buffer
 {
 	char				*	buf;
@@ -126,6 +150,13 @@ BUF *strbuf_json( BUF *b, json_object *o, int done );
 // get string length, up to a maximum
 int str_nlen( const char *src, int max );
 
+// locale-free replacement for strtod on data values
+double str_to_dbl( const char *str, char **end );
+
+// find lines and field separators in a buffer in one pass
+int str_scan_lines( const char *buf, int len, const char *seps, SCANL *lines, int max );
+void str_scan_shift( SCANL *l );
+
 // remove NL\CR and report len change
 int chomp( char *s, int len );
 
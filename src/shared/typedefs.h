@@ -51,6 +51,11 @@ typedef struct file_tree            FTREE;
 typedef struct mem_call_counters    MCCTR;
 typedef struct mem_type_counters    MTCTR;
 typedef struct mem_type_stats       MTSTAT;
+typedef struct mem_mag_counters     MTMCTR;
+typedef struct mem_mag_thread_stats MTMTS;
+typedef struct mem_magazine         MTMAG;
+typedef struct mem_thread_cache     MTCACHE;
+typedef struct mem_slab             MSLAB;
 typedef struct mem_type_blank       MTBLANK;
 typedef struct mem_type             MTYPE;
 typedef struct mem_check            MCHK;
@@ -75,6 +80,7 @@ typedef struct iplist               IPLIST;
 typedef struct host_tracker         HTRACK;
 typedef struct host_data            HOST;
 typedef struct tcp_thread           TCPTH;
+typedef struct udp_batch            UDPBT;
 
 typedef struct net_prefix           NET_PFX;
 typedef struct net_type             NET_TYPE;
@@ -91,6 +97,7 @@ typedef struct regex_list           RGXL;
 
 typedef struct words_data           WORDS;
 typedef struct string_buffer        BUF;
+typedef struct str_scan_line        SCANL;
 typedef struct string_store_entry   SSTE;
 typedef struct string_store         SSTR;
 